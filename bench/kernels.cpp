@@ -0,0 +1,217 @@
+#include "Triangle.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Inputs are cycled with a mask rather than a 64-bit modulo, which would dominate the cheap kernels
+#define INPUTS 1024
+#define WRAP(i) ((i) & (INPUTS - 1))
+#define DEFAULT_SAMPLES 31
+#define WARMUP_NS 50000000LL
+#define SAMPLE_NS 2000000LL
+
+static_assert((INPUTS & (INPUTS - 1)) == 0, "INPUTS must be a power of two");
+
+// Forces the compiler to materialize a value without emitting any code for it
+template <typename T>
+static inline void keep(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+// Makes the compiler forget what it knows about memory, so inputs are reloaded every iteration
+static inline void clobber() {
+    asm volatile("" : : : "memory");
+}
+
+struct Result {
+    std::string name;
+    long long batch;
+    std::vector<double> samples;
+    double median, mad, min;
+};
+
+typedef std::function<void(long long)> Kernel;
+
+static long long now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static long long time_batch(const Kernel& kernel, long long batch) {
+    long long begin = now_ns();
+    kernel(batch);
+    return now_ns() - begin;
+}
+
+// Warms up, grows the batch until one sample takes SAMPLE_NS, then keeps `samples` timed batches.
+// The median and median absolute deviation are robust against preemption spikes.
+static Result run(const std::string& name, const Kernel& kernel, int samples) {
+    Result result;
+    result.name = name;
+
+    long long warm_until = now_ns() + WARMUP_NS;
+    while (now_ns() < warm_until)
+        kernel(1024);
+
+    long long batch = 1;
+    while (time_batch(kernel, batch) < SAMPLE_NS && batch < (1LL << 40))
+        batch *= 2;
+    result.batch = batch;
+
+    for (int i = 0; i < samples; i++)
+        result.samples.push_back(time_batch(kernel, batch) / (double)batch);
+
+    std::vector<double> sorted(result.samples);
+    std::sort(sorted.begin(), sorted.end());
+    result.median = sorted[sorted.size() / 2];
+    result.min = sorted.front();
+    std::vector<double> deviation;
+    for (double s : sorted)
+        deviation.push_back(std::fabs(s - result.median));
+    std::sort(deviation.begin(), deviation.end());
+    result.mad = deviation[deviation.size() / 2];
+    return result;
+}
+
+static float random_float(std::mt19937& rng, float lo, float hi) {
+    return std::uniform_real_distribution<float>(lo, hi)(rng);
+}
+
+static Vector4 random_vector(std::mt19937& rng, float w) {
+    return Vector4(random_float(rng, -1, 1), random_float(rng, -1, 1), random_float(rng, -1, 1), w);
+}
+
+static Matrix4 random_matrix(std::mt19937& rng) {
+    float m[16];
+    for (float& f : m)
+        f = random_float(rng, -1, 1);
+    return Matrix4(m);
+}
+
+int main(int argc, char** argv) {
+    bool json = false;
+    int samples = DEFAULT_SAMPLES;
+    std::string filter;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json"))
+            json = true;
+        else if (!strncmp(argv[i], "--samples=", 10))
+            samples = std::max(3, atoi(argv[i] + 10));
+        else if (!strncmp(argv[i], "--filter=", 9))
+            filter = argv[i] + 9;
+        else {
+            fprintf(stderr, "usage: %s [--json] [--samples=N] [--filter=SUBSTRING]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Inputs are drawn from a fixed seed and cycled through so no result can be precomputed
+    std::mt19937 rng(42);
+    std::vector<Matrix4> matrices;
+    std::vector<Vector4> vectors, points, planes;
+    std::vector<Triangle> triangles, projected;
+    std::vector<std::pair<float, float>> samples_xy;
+    Matrix4 P = Matrix4::Perspective(1, 60, 1000, 0.3) * Matrix4::Translation(0, 0, 35);
+    for (int i = 0; i < INPUTS; i++) {
+        matrices.push_back(random_matrix(rng));
+        vectors.push_back(random_vector(rng, 0));
+        points.push_back(random_vector(rng, 1));
+        triangles.push_back(Triangle(random_vector(rng, 1), random_vector(rng, 1), random_vector(rng, 1)));
+        projected.push_back(P * triangles.back());
+        planes.push_back(projected.back().normal());
+        samples_xy.push_back({random_float(rng, -0.05, 0.05), random_float(rng, -0.05, 0.05)});
+    }
+
+    std::vector<std::pair<std::string, Kernel>> kernels = {
+        {"Matrix4*Matrix4", [&](long long n) {
+            for (long long i = 0; i < n; i++) {
+                clobber();
+                Matrix4 r = matrices[WRAP(i)] * matrices[WRAP(i + 1)];
+                keep(r);
+            }
+        }},
+        {"Matrix4*Vector4", [&](long long n) {
+            for (long long i = 0; i < n; i++) {
+                clobber();
+                Vector4 r = matrices[WRAP(i)] * points[WRAP(i)];
+                keep(r);
+            }
+        }},
+        {"Vector4::normalize", [&](long long n) {
+            for (long long i = 0; i < n; i++) {
+                clobber();
+                Vector4 r = vectors[WRAP(i)].normalize();
+                keep(r);
+            }
+        }},
+        {"Vector4::cross", [&](long long n) {
+            for (long long i = 0; i < n; i++) {
+                clobber();
+                Vector4 r = vectors[WRAP(i)].cross(vectors[WRAP(i + 1)]);
+                keep(r);
+            }
+        }},
+        {"Triangle::contains", [&](long long n) {
+            float z;
+            for (long long i = 0; i < n; i++) {
+                clobber();
+                const std::pair<float, float>& xy = samples_xy[WRAP(i)];
+                bool r = projected[WRAP(i)].contains(xy.first, xy.second, z);
+                keep(r);
+                keep(z);
+            }
+        }},
+        {"Triangle::contains (plane)", [&](long long n) {
+            float z;
+            for (long long i = 0; i < n; i++) {
+                clobber();
+                const std::pair<float, float>& xy = samples_xy[WRAP(i)];
+                bool r = projected[WRAP(i)].contains(xy.first, xy.second, planes[WRAP(i)], z);
+                keep(r);
+                keep(z);
+            }
+        }},
+        {"Triangle::normal", [&](long long n) {
+            for (long long i = 0; i < n; i++) {
+                clobber();
+                Vector4 r = triangles[WRAP(i)].normal();
+                keep(r);
+            }
+        }},
+        {"Matrix4*Triangle", [&](long long n) {
+            for (long long i = 0; i < n; i++) {
+                clobber();
+                Triangle r = P * triangles[WRAP(i)];
+                keep(r);
+            }
+        }},
+    };
+
+    std::vector<Result> results;
+    for (const auto& kernel : kernels) {
+        if (!filter.empty() && kernel.first.find(filter) == std::string::npos)
+            continue;
+        results.push_back(run(kernel.first, kernel.second, samples));
+        if (!json) {
+            const Result& r = results.back();
+            printf("%-28s %10.2f ns/op  +-%6.2f  min %10.2f  %12.0f ops/s\n", r.name.c_str(), r.median, r.mad, r.min, 1e9 / r.median);
+        }
+    }
+
+    if (json) {
+        printf("{\n  \"samples\": %d,\n  \"kernels\": [\n", samples);
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            printf("    {\"name\": \"%s\", \"ns_per_op\": %.4f, \"mad_ns\": %.4f, \"min_ns\": %.4f, \"ops_per_sec\": %.1f, \"batch\": %lld}%s\n",
+                   r.name.c_str(), r.median, r.mad, r.min, 1e9 / r.median, r.batch, i + 1 < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+    }
+    return 0;
+}
\ No newline at end of file
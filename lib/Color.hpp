@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+
+class Color {
+    public:
+        uint8_t r, g, b;
+
+        Color();
+        Color(uint8_t r, uint8_t g, uint8_t b);
+        Color operator*(float intensity) const;
+        bool operator==(const Color& color) const;
+        bool operator!=(const Color& color) const;
+
+        uint32_t quantize256() const;
+        uint32_t quantize(int levels) const;
+};
\ No newline at end of file
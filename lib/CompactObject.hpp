@@ -0,0 +1,28 @@
+#pragma once
+#include "Object.hpp"
+#include <cstdint>
+#include <vector>
+
+// Indexed mesh with 16-bit positions quantized inside the mesh AABB and octahedral 16-bit normals.
+// Decoding is folded into the transform: dequantization() maps the integer grid back to object space.
+class CompactObject {
+    private:
+        Vector4 origin, extent;
+        std::vector<uint16_t> positions;
+        std::vector<uint32_t> indices;
+        std::vector<int16_t> packed_normals;
+        Color _color;
+
+    public:
+        CompactObject();
+        CompactObject(const Object& obj);
+
+        size_t vertex_count() const;
+        size_t triangle_count() const;
+        size_t bytes() const;
+        Color color() const;
+        const uint32_t* triangle(int idx) const;
+        Vector4 normal(int idx) const;
+        Matrix4 dequantization() const;
+        void transform(const Matrix4& M, std::vector<Vector4>& out) const;
+};
\ No newline at end of file
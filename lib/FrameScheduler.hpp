@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+class Histogram {
+    private:
+        std::vector<uint64_t> buckets;
+        uint64_t count, max_value;
+
+        static int bucket(uint64_t value);
+        static uint64_t bucket_value(int idx);
+
+    public:
+        Histogram();
+        void record(uint64_t value);
+        void reset();
+        uint64_t percentile(double q) const;
+        uint64_t max() const;
+        uint64_t samples() const;
+};
+
+class FrameScheduler {
+    private:
+        struct timespec origin, deadline, frame_start;
+        int64_t period;
+        uint64_t skipped;
+        Histogram frame_hist, jitter_hist;
+
+    public:
+        FrameScheduler(int fps);
+        void set_fps(int fps);
+        double elapsed() const;
+        void wait();
+
+        const Histogram& frame_times() const;
+        const Histogram& jitter() const;
+        uint64_t skipped_frames() const;
+};
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem {
+    private:
+        struct Task {
+            std::function<void()> fn;
+            std::atomic<int>* pending;
+        };
+
+        struct Worker {
+            std::mutex lock;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Worker>> queues;
+        std::vector<std::thread> threads;
+        std::atomic<int> queued;
+        std::atomic<bool> stopping;
+        std::mutex sleep_lock;
+        std::condition_variable wake;
+
+        int queue_index() const;
+        bool pop(int idx, Task& task);
+        bool steal(int idx, Task& task);
+        bool run_one(int idx);
+        void worker_loop(int idx);
+        void split_for(int begin, int end, int grain, const std::function<void(int, int)>& body, std::atomic<int>& pending);
+
+    public:
+        static JobSystem& global();
+        // Worker count of the global pool; only takes effect before its first use
+        static bool set_global_workers(int workers);
+
+        JobSystem(int workers);
+        ~JobSystem();
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        void submit(std::function<void()> fn, std::atomic<int>& pending);
+        void wait(std::atomic<int>& pending);
+        void parallel_for(int begin, int end, int grain, const std::function<void(int, int)>& body);
+        int concurrency() const;
+};
+
+class TaskGraph {
+    private:
+        struct Node {
+            std::function<void()> fn;
+            std::vector<int> successors;
+            int dependencies = 0;
+        };
+
+        std::vector<Node> nodes;
+
+    public:
+        int add(std::function<void()> fn);
+        void precede(int before, int after);
+        void run(JobSystem& jobs = JobSystem::global());
+};
@@ -62,5 +62,6 @@ class Matrix4 {
         friend Matrix4 operator*(const float& scalar, const Matrix4& mat);
 
         Vector4 operator*(const Vector4& vec) const;
+        Matrix4 normal_matrix() const;
         friend std::ostream& operator<<(std::ostream& os, const Matrix4 mat);
 };
\ No newline at end of file
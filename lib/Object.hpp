@@ -1,15 +1,36 @@
 #pragma once
-#include <list>
+#include <vector>
 #include <iostream>
+#include <atomic>
+#include <mutex>
 #include "Triangle.hpp"
+#include "Color.hpp"
 
 class Object {
+    private:
+        mutable std::vector<Vector4> _normals;
+        mutable std::atomic<bool> setup_valid{false};
+        mutable std::mutex setup_lock;
+
     protected:
-        std::list<Triangle> mesh;
+        std::vector<Triangle> mesh;
+        Color _color;
+
+        void invalidate();
     public:
         Object();
-        Object(std::list<Triangle>& mesh);
-        std::list<Triangle> triangles() const;
+        Object(const std::vector<Triangle>& mesh);
+        Object(const std::vector<Triangle>& mesh, const Color& color);
+        Object(std::vector<Triangle>&& mesh);
+        Object(std::vector<Triangle>&& mesh, const Color& color);
+        Object(const Object& obj);
+        Object(Object&& obj);
+        Object& operator=(const Object& obj);
+        Object& operator=(Object&& obj);
+        const std::vector<Triangle>& triangles() const;
+        const std::vector<Vector4>& normals() const;
+        Color color() const;
+        void set_color(const Color& color);
         void bounding(float& x0, float& y0, float& x1, float& y1) const;
         friend Object operator*(const Matrix4& proj, const Object& obj);
         friend std::ostream& operator<<(std::ostream& os, const Object& obj);
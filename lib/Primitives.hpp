@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Vertex and index tables of the built-in solids, fixed at compile time. Irrational coordinates are
+// written out as literals rounded the same way the std::sqrt expressions they replace were.
+namespace Primitives {
+    struct Vertex {
+        float x, y, z;
+    };
+
+    struct Face {
+        uint8_t v0, v1, v2;
+    };
+
+    template <size_t V, size_t F>
+    constexpr bool indices_valid(const Vertex (&)[V], const Face (&faces)[F]) {
+        for (size_t i = 0; i < F; i++)
+            if (faces[i].v0 >= V || faces[i].v1 >= V || faces[i].v2 >= V)
+                return false;
+        return true;
+    }
+
+    // Unit cube; vertex i sits at +0.5 along x, y and z where bits 0, 1 and 2 of i are set
+    constexpr Vertex cube_vertices[8] = {
+        {-0.5, -0.5, -0.5}, { 0.5, -0.5, -0.5}, {-0.5,  0.5, -0.5}, { 0.5,  0.5, -0.5},
+        {-0.5, -0.5,  0.5}, { 0.5, -0.5,  0.5}, {-0.5,  0.5,  0.5}, { 0.5,  0.5,  0.5}
+    };
+
+    // Two triangles per side, split along the same diagonal RectangularMesh uses
+    constexpr Face cube_faces[12] = {
+        {0, 2, 3}, {0, 3, 1},
+        {4, 5, 7}, {4, 7, 6},
+        {0, 4, 6}, {0, 6, 2},
+        {1, 3, 7}, {1, 7, 5},
+        {0, 1, 5}, {0, 5, 4},
+        {2, 6, 7}, {2, 7, 3}
+    };
+
+    constexpr double SQRT2 = 1.41421356237309504880;
+    constexpr double SQRT6 = 2.44948974278317809820;
+    constexpr double SQRT8 = 2.82842712474619009760;
+
+    constexpr Vertex tetrahedron_vertices[4] = {
+        {(float)SQRT8, 0, -1}, {(float)-SQRT2, (float)SQRT6, -1}, {(float)-SQRT2, (float)-SQRT6, -1}, {0, 0, 3}
+    };
+
+    constexpr Face tetrahedron_faces[4] = {
+        {0, 1, 2}, {0, 3, 2}, {0, 1, 3}, {3, 1, 2}
+    };
+
+    // Golden ratio
+    constexpr float T = (1.0 + 2.23606797749978969641) / 2;
+
+    constexpr Vertex icosahedron_vertices[12] = {
+        {-1,  T,  0}, { 1,  T,  0}, {-1, -T,  0}, { 1, -T,  0},
+        { 0, -1,  T}, { 0,  1,  T}, { 0, -1, -T}, { 0,  1, -T},
+        { T,  0, -1}, { T,  0,  1}, {-T,  0, -1}, {-T,  0,  1}
+    };
+
+    constexpr Face icosahedron_faces[20] = {
+        { 0, 11,  5}, { 0,  5,  1}, { 0,  1,  7}, { 0,  7, 10}, { 0, 10, 11},
+        { 1,  5,  9}, { 5, 11,  4}, {11, 10,  2}, {10,  7,  6}, { 7,  1,  8},
+        { 3,  9,  4}, { 3,  4,  2}, { 3,  2,  6}, { 3,  6,  8}, { 3,  8,  9},
+        { 4,  9,  5}, { 2,  4, 11}, { 6,  2, 10}, { 8,  6,  7}, { 9,  8,  1}
+    };
+
+    static_assert(indices_valid(cube_vertices, cube_faces), "cube face out of range");
+    static_assert(indices_valid(tetrahedron_vertices, tetrahedron_faces), "tetrahedron face out of range");
+    static_assert(indices_valid(icosahedron_vertices, icosahedron_faces), "icosahedron face out of range");
+}
\ No newline at end of file
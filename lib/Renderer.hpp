@@ -1,26 +1,95 @@
 #pragma once
 #include "Object.hpp"
+#include "CompactObject.hpp"
+#include <ostream>
+#include <vector>
+
+enum class ColorMode { None, Palette256, TrueColor };
+enum class DepthFormat { Float32, Unorm16 };
 
 class Renderer {
     private:
         int _width, _height;
         float zfar, znear;
+        float depth16_far;
         int dirty_x0, dirty_y0, dirty_x1, dirty_y1;
+        bool repaint;
+        int _frame_stride, _depth_stride, _color_stride;
+        bool owns_frame, owns_depth;
+        void *frame_storage, *depth_storage, *color_storage;
+        size_t frame_capacity, depth_capacity, color_capacity;
         char *frame_buffer;
         float *depth_buffer;
+        uint16_t *depth16_buffer;
+        uint32_t *color_buffer;
+        ColorMode frame_color_mode;
+
+        struct Setup {
+            Triangle tri;
+            Vector4 plane;
+            Vector4 normal;
+            int x0, y0, x1, y1;
+            Color color;
+        };
+        struct TileRange {
+            int x0, y0, x1, y1;
+        };
+        mutable std::vector<uint8_t> tile_cleared;
+        std::vector<Setup> setups;
+        std::vector<TileRange> tile_ranges;
+        std::vector<uint32_t> bin_offsets;
+        std::vector<uint32_t> bin_entries;
+        std::vector<uint32_t> bin_fill;
+        std::vector<Vector4> clip_vertices;
+
+        static void reserve(void*& storage, size_t& capacity, size_t bytes);
+        void allocate(DepthFormat format);
+        int tile_count() const;
+        void clear_tile(int tile) const;
+        void resolve(int x0, int y0, int x1, int y1) const;
+        uint16_t encode_depth(float z) const;
+        void setup(const std::vector<const Object*>& objs, const std::vector<int>& offsets,
+                   const std::vector<Matrix4>& PM, const std::vector<Matrix4>& N, int begin, int end);
+        void setup(const CompactObject& obj, const Matrix4& N, int begin, int end);
+        void scan_bounds(Setup& s) const;
+        void bin(const Matrix4& P, float intensity);
+        void rasterize(const Matrix4& P, const Setup& s, float intensity, int x0, int y0, int x1, int y1);
 
         float fragment2intensity(const Vector4& pos, const Vector4& normal, float intensity);
         char intensity2char(float intensity);
+        uint32_t color2code(const Color& color) const;
+        void emit_color(std::ostream& os, uint32_t code) const;
 
     public:
         bool detail_charset = false;
+        ColorMode color_mode = ColorMode::None;
+        int color_levels = 16;
+        int bin_capacity = 1 << 16;
 
         Renderer(int widht, int height, float zfar, float znear);
         ~Renderer();
         void clear();
         void draw(const Matrix4& P, const Object& obj, float intensity);
+        void draw(const Matrix4& P, const Matrix4& M, const Object& obj, float intensity);
+        void draw(const Matrix4& P, const Matrix4& M, const CompactObject& obj, float intensity);
+        void draw(const Matrix4& P, const std::vector<const Object*>& objs, float intensity);
+        void draw(const Matrix4& P, const std::vector<const Object*>& objs, const std::vector<Matrix4>& models, float intensity);
         void render();
+        // Renders into caller-owned memory from now on; strides count elements per row and a null pointer
+        // goes back to internal storage. The depth pointer type picks the depth format. Until set_size.
+        // Internal rows are padded to whole cache lines, so read frame() and depth() through the strides.
+        bool bind(char* frame, int frame_stride, float* depth, int depth_stride);
+        bool bind(char* frame, int frame_stride, uint16_t* depth, int depth_stride);
+        void flush() const;
         void set_size(int width, int height);
+        void set_depth_format(DepthFormat format);
+        DepthFormat depth_format() const;
         float width() const;
         float height() const;
+        int frame_stride() const;
+        int depth_stride() const;
+        bool occluded(float x0, float y0, float x1, float y1, float z) const;
+        const char* frame() const;
+        const float* depth() const;
+        const uint16_t* depth16() const;
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+#include "Renderer.hpp"
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AABB {
+    Vector4 min, max;
+};
+
+// Collects triangles in a scratch file and writes them out as spatially coherent chunks.
+// Memory use while building is bounded by memory_budget plus a few bytes per grid cell, not by the input size.
+class StreamingMeshBuilder {
+    private:
+        std::string scratch_path;
+        FILE* scratch;
+        uint64_t count;
+        AABB bounds;
+        Color _color;
+
+    public:
+        StreamingMeshBuilder(const std::string& scratch_path);
+        ~StreamingMeshBuilder();
+        void add(const Triangle& tri);
+        void add(const Object& obj);
+        void set_color(const Color& color);
+        bool finish(const std::string& path, int chunk_triangles = 4096, size_t memory_budget = 64 << 20);
+};
+
+// Chunked mesh that stays on disk. Only chunks that survive frustum and occlusion culling are
+// paged in, resident chunks are kept under an LRU byte budget, and a background thread prefetches
+// the chunks the camera is moving towards.
+class StreamingMesh {
+    private:
+        struct Chunk {
+            AABB bounds;
+            uint64_t offset;
+            uint32_t count;
+        };
+
+        struct Resident {
+            std::shared_ptr<const Object> obj;
+            std::list<int>::iterator lru;
+            uint64_t frame;
+            bool loading;
+        };
+
+        struct Visible {
+            int chunk;
+            float x0, y0, x1, y1, z;
+        };
+
+        int fd;
+        Color _color;
+        std::vector<Chunk> chunks;
+        std::vector<Resident> resident;
+        std::list<int> lru;
+        size_t budget, used;
+        uint64_t frame;
+        Matrix4 last_mvp;
+        bool has_last;
+
+        std::mutex lock;
+        std::condition_variable loaded;
+        std::condition_variable wake;
+        std::deque<int> prefetch_queue;
+        bool stopping;
+        std::thread prefetcher;
+
+        static size_t chunk_bytes(const Chunk& chunk);
+        bool project(const Chunk& chunk, const Matrix4& mvp, Visible& out) const;
+        std::shared_ptr<const Object> read_chunk(int idx) const;
+        std::shared_ptr<const Object> acquire(int idx);
+        bool make_room(size_t bytes, bool keep_current);
+        void prefetch_loop();
+
+    public:
+        StreamingMesh(const std::string& path, size_t budget_bytes);
+        ~StreamingMesh();
+        StreamingMesh(const StreamingMesh&) = delete;
+        StreamingMesh& operator=(const StreamingMesh&) = delete;
+
+        bool is_open() const;
+        size_t chunk_count() const;
+        size_t resident_bytes();
+        void draw(Renderer& renderer, const Matrix4& P, const Matrix4& M, float intensity);
+};
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include "Matrix.hpp"
+#include <vector>
+
+class Transform {
+    private:
+        float translation[3];
+        float rotation[4];
+        float scale[3];
+        Transform* parent;
+        std::vector<Transform*> children;
+
+        mutable Matrix4 local, world, normal;
+        mutable bool local_dirty, world_dirty, normal_dirty;
+
+        void mark_dirty();
+
+    public:
+        Transform();
+        ~Transform();
+        Transform(const Transform&) = delete;
+        Transform& operator=(const Transform&) = delete;
+
+        void set_parent(Transform* parent);
+        void set_translation(float x, float y, float z);
+        void set_rotation(float w, float x, float y, float z);
+        void set_rotation(float x, float y, float z);
+        void set_scale(float x, float y, float z);
+
+        const Matrix4& local_matrix() const;
+        const Matrix4& world_matrix() const;
+        const Matrix4& normal_matrix() const;
+};
\ No newline at end of file
@@ -7,6 +7,7 @@ class Triangle {
         Vector4 vertex[3];
 
     public:
+        Triangle();
         Triangle(const Vector4 vert0, const Vector4 vert1, const Vector4 vert2);
         Vector4& operator[](const int coord);
         Vector4 operator[](const int coord) const;
@@ -15,6 +16,7 @@ class Triangle {
         friend Triangle operator*(const Matrix4& proj, const Triangle& tri);
 
         bool contains(float x, float y, float& z) const;
+        bool contains(float x, float y, const Vector4& normal, float& z) const;
         void bounding(float& x0, float& y0, float& x1, float& y1) const;
         Vector4 normal() const;
         friend std::ostream& operator<<(std::ostream& os, const Triangle tri);
@@ -0,0 +1,39 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Single-producer/single-consumer handoff: the writer fills its private slot and publishes it
+// with one atomic exchange, the reader picks up the newest published slot the same way.
+// Neither side ever waits for the other.
+template <typename T>
+class TripleBuffer {
+    private:
+        static const uint8_t FRESH = 4;
+
+        T buffers[3];
+        std::atomic<uint8_t> middle;
+        uint8_t back, front;
+
+    public:
+        TripleBuffer(const T& init) :
+            buffers{init, init, init}, middle(1), back(0), front(2) {}
+
+        T& write_buffer() {
+            return buffers[back];
+        }
+
+        void publish() {
+            back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+        }
+
+        void write(const T& value) {
+            write_buffer() = value;
+            publish();
+        }
+
+        const T& read() {
+            if (middle.load(std::memory_order_relaxed) & FRESH)
+                front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+            return buffers[front];
+        }
+};
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef ASCII3D_H
+#define ASCII3D_H
+#include <stdint.h>
+
+/*
+ * C interface of libascii3d. Handles are opaque; matrices are 16 floats in row-major order
+ * applied to column vectors, the same layout as Matrix4. Functions returning int give
+ * A3D_OK or a negative error code.
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define A3D_API_VERSION 1
+
+#define A3D_OK 0
+#define A3D_EINVAL -1
+#define A3D_ENOMEM -2
+#define A3D_EBUSY -3
+
+#define A3D_DEPTH_FLOAT32 0
+#define A3D_DEPTH_UNORM16 1
+
+typedef struct a3d_renderer a3d_renderer;
+typedef struct a3d_mesh a3d_mesh;
+
+int a3d_api_version(void);
+/* Drawing spreads work over a process-wide pool that starts on the first draw, with one thread fewer
+   than the hardware supports unless set here first. 0 draws on the calling thread only. Returns
+   A3D_EBUSY once the pool is running. */
+int a3d_set_worker_threads(int count);
+
+/* A renderer is used by one thread at a time; separate renderers are independent */
+a3d_renderer* a3d_renderer_create(int width, int height, float zfar, float znear);
+void a3d_renderer_destroy(a3d_renderer* renderer);
+/* Renders straight into caller memory: frame holds frame_stride chars per row, depth holds depth_stride
+   floats (A3D_DEPTH_FLOAT32) or uint16_t (A3D_DEPTH_UNORM16) per row. NULL selects internal storage.
+   The memory must outlive the binding, which ends with a3d_renderer_set_size or another bind. */
+int a3d_renderer_bind(a3d_renderer* renderer, char* frame, int frame_stride, void* depth, int depth_stride, int depth_format);
+int a3d_renderer_set_size(a3d_renderer* renderer, int width, int height);
+void a3d_renderer_set_detail_charset(a3d_renderer* renderer, int detail);
+void a3d_renderer_clear(a3d_renderer* renderer);
+int a3d_renderer_draw(a3d_renderer* renderer, const float projection[16], const float model[16], const a3d_mesh* mesh, float intensity);
+/* Completes the frame in the bound buffers; call after the last draw and before reading them */
+void a3d_renderer_finish(a3d_renderer* renderer);
+const char* a3d_renderer_frame(a3d_renderer* renderer, int* stride);
+
+/* Nine floats per triangle, one xyz triple per vertex. A mesh is immutable apart from its color, so
+   several renderers may draw it from different threads; a3d_mesh_set_color must not overlap a draw. */
+a3d_mesh* a3d_mesh_create(const float* vertices, int triangle_count);
+a3d_mesh* a3d_mesh_create_indexed(const float* positions, int vertex_count, const uint32_t* indices, int triangle_count);
+void a3d_mesh_set_color(a3d_mesh* mesh, uint8_t r, uint8_t g, uint8_t b);
+void a3d_mesh_destroy(a3d_mesh* mesh);
+
+void a3d_perspective(float out[16], float aspect, float fov, float zfar, float znear);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
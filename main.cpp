@@ -1,24 +1,43 @@
 #include "Renderer.hpp"
+#include "TripleBuffer.hpp"
+#include "FrameScheduler.hpp"
+#include "Transform.hpp"
 #include <iostream>
+#include <memory>
 #include <unistd.h>
+#include <cstdio>
 #include <cmath>
 #include <atomic>
 #include <thread>
 #include <termios.h>
+#include <csignal>
+#include <sys/ioctl.h>
 
 std::atomic_bool stop(false);
+// Set by SIGWINCH, consumed by the render thread between frames
+std::atomic_bool resized(false);
 
 Renderer renderer(64, 48, 1000, 0.3);
-Matrix4 P, M;
-Object mesh;
+Matrix4 P;
 
-int fps = 60;
-float trans_mag = 1.5;
-float trans_freq = 0.08;
-float rot_freq_x = 0.2;
-float rot_freq_y = 0.8;
-float rot_freq_z = 1.0;
-float scale = 4.5;
+// Animation advances by this many steps per second, which matches one step per frame at 60 fps
+const float animation_rate = 60;
+
+// Everything the input thread may change; published to the render thread as a whole
+struct SceneState {
+    std::shared_ptr<const Object> mesh;
+    int fps = 60;
+    float trans_mag = 1.5;
+    float trans_freq = 0.08;
+    float rot_freq_x = 0.2;
+    float rot_freq_y = 0.8;
+    float rot_freq_z = 1.0;
+    float scale = 4.5;
+    bool detail_charset = false;
+    ColorMode color_mode = ColorMode::None;
+};
+
+TripleBuffer<SceneState> scene_state{SceneState()};
 
 int getch(void)
 {
@@ -33,21 +52,57 @@ int getch(void)
     return ch;
 }
 
-void render() {
-    float angle = 0;
-    float ytrans = 0;
+void on_resize(int) {
+    resized = true;
+}
+
+// Follows the terminal, keeping the last row free for the cursor
+void fit_terminal() {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 1)
+        renderer.set_size(ws.ws_col, ws.ws_row - 1);
+    P = Matrix4::Perspective((renderer.width() / 2.0) / renderer.height(), 60, 1000, 0.3);
+}
+
+void render(FrameScheduler& scheduler) {
+    // The bobbing anchor carries the spinning, scaled mesh
+    Transform anchor, body;
+    body.set_parent(&anchor);
     while(!stop) {
+        if (resized.exchange(false))
+            fit_terminal();
+        const SceneState& state = scene_state.read();
+        scheduler.set_fps(state.fps);
+        // Kept in double and wrapped before narrowing, so the motion stays smooth after hours of running
+        double angle = animation_rate * scheduler.elapsed();
+        double ytrans = angle;
+        renderer.detail_charset = state.detail_charset;
+        renderer.color_mode = state.color_mode;
         renderer.clear();
-        M = Matrix4::Translation(0, trans_mag*std::cos(trans_freq*ytrans), 35) * Matrix4::Rotation(0, rot_freq_x*angle) * Matrix4::Rotation(1, rot_freq_y*angle) * Matrix4::Rotation(2, rot_freq_z*angle) * Matrix4::Scale(scale, scale, scale);
-        renderer.draw(P, M * mesh, 0.8);
+        anchor.set_translation(0, state.trans_mag*std::cos(state.trans_freq*ytrans), 35);
+        body.set_rotation(std::fmod(state.rot_freq_x*angle, 720.0), std::fmod(state.rot_freq_y*angle, 720.0), std::fmod(state.rot_freq_z*angle, 720.0));
+        body.set_scale(state.scale, state.scale, state.scale);
+        if (state.mesh)
+            renderer.draw(P, body.world_matrix(), *state.mesh, 0.8);
         renderer.render();
-        angle += 1;
-        ytrans += 1;
-        usleep(1000.0*1000/fps);
+        scheduler.wait();
     }
 }
 
-void update_mesh(int idx) {
+void print_stats(const char* name, const Histogram& hist) {
+    printf("%-10s p50 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n", name,
+           hist.percentile(0.5) / 1e6, hist.percentile(0.99) / 1e6, hist.max() / 1e6);
+}
+
+const int mesh_num = 6;
+
+// Each mesh is built the first time it is picked and kept, along with the face normals the renderer
+// caches on it, so switching back to it later costs nothing
+std::shared_ptr<const Object> create_mesh(int idx) {
+    static std::shared_ptr<const Object> meshes[mesh_num];
+    if (meshes[idx])
+        return meshes[idx];
+    Object mesh;
     switch (idx) {
         case 0:
             mesh = TriangularMesh(
@@ -55,6 +110,7 @@ void update_mesh(int idx) {
                 Vector4( 1, -1, 0, 1),
                 Vector4( 0, std::sqrt(3)-1, 0, 1)
             );
+            mesh.set_color(Color(255, 215, 0));
             break;
         case 1:
             mesh = RectangularMesh(
@@ -63,100 +119,126 @@ void update_mesh(int idx) {
                 Vector4( 1,  1, 0, 1),
                 Vector4( 1, -1, 0, 1)
             );
+            mesh.set_color(Color(0, 175, 255));
             break;
         case 2:
             mesh = Matrix4::Scale(0.5, 0.5, 0.5) * TetrahedronMesh();
+            mesh.set_color(Color(255, 95, 95));
             break;
         case 3:
             mesh = Matrix4::Scale(2, 2, 2) * CubeMesh();
+            mesh.set_color(Color(95, 255, 135));
             break;
         case 4:
             mesh = IcosahedronMesh();
+            mesh.set_color(Color(175, 135, 255));
             break;
         case 5:
             mesh = SphereMesh(1);
+            mesh.set_color(Color(255, 175, 95));
             break;
     }
+    meshes[idx] = std::make_shared<const Object>(std::move(mesh));
+    return meshes[idx];
 }
 
 int main(int argc, char** argv) {
-    if (argc == 3)
+    // An explicit size on the command line turns off following the terminal
+    if (argc == 3) {
         renderer.set_size(atoi(argv[1]), atoi(argv[2]));
-    P = Matrix4::Perspective((renderer.width() / 2.0) / renderer.height(), 60, 1000, 0.3);
+        P = Matrix4::Perspective((renderer.width() / 2.0) / renderer.height(), 60, 1000, 0.3);
+    }
+    else {
+        struct sigaction action = {};
+        action.sa_handler = on_resize;
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGWINCH, &action, nullptr);
+        fit_terminal();
+    }
 
     int mesh_type = 0;
-    int mesh_num = 6;
-    update_mesh(mesh_type);
+    SceneState state;
+    state.mesh = create_mesh(mesh_type);
+    scene_state.write(state);
 
-    std::thread t(render);
+    FrameScheduler scheduler(state.fps);
+    std::thread t(render, std::ref(scheduler));
     char c;
     while ((c = getch())) {
         if (c == 'q') break;
         switch (c) {
             case 'v':
-                renderer.detail_charset ^= 1;
+                state.detail_charset ^= 1;
                 break;           
+            case 'k':
+                state.color_mode = (ColorMode)(((int)state.color_mode + 1) % 3);
+                break;
             case 'p':
                 mesh_type = (mesh_type + 1) % mesh_num;
-                update_mesh(mesh_type);
+                state.mesh = create_mesh(mesh_type);
                 break;
             case 'o':
                 mesh_type = (mesh_type - 1 + mesh_num) % mesh_num;
-                update_mesh(mesh_type);
+                state.mesh = create_mesh(mesh_type);
                 break;
             case 'u':
-                fps--;
-                if (fps < 1) fps = 1;
+                state.fps--;
+                if (state.fps < 1) state.fps = 1;
                 break;
             case 'i':
-                fps++;
+                state.fps++;
                 break;
             case 'a':
-                rot_freq_x -= 0.01;
-                rot_freq_x = rot_freq_x < 0 ? 0 : rot_freq_x;
+                state.rot_freq_x -= 0.01;
+                state.rot_freq_x = state.rot_freq_x < 0 ? 0 : state.rot_freq_x;
                 break;
             case 'z':
-                rot_freq_x += 0.01;
+                state.rot_freq_x += 0.01;
                 break;
             case 's':
-                rot_freq_y -= 0.01;
-                rot_freq_y = rot_freq_y < 0 ? 0 : rot_freq_y;
+                state.rot_freq_y -= 0.01;
+                state.rot_freq_y = state.rot_freq_y < 0 ? 0 : state.rot_freq_y;
                 break;
             case 'x':
-                rot_freq_y += 0.01;
+                state.rot_freq_y += 0.01;
                 break;
             case 'd':
-                rot_freq_z -= 0.01;
-                rot_freq_z = rot_freq_z < 0 ? 0 : rot_freq_z;
+                state.rot_freq_z -= 0.01;
+                state.rot_freq_z = state.rot_freq_z < 0 ? 0 : state.rot_freq_z;
                 break;
             case 'c':
-                rot_freq_z += 0.01;
+                state.rot_freq_z += 0.01;
                 break;
             case 't':
-                trans_freq -= 0.01;
-                trans_freq = trans_freq < 0 ? 0 : trans_freq;
+                state.trans_freq -= 0.01;
+                state.trans_freq = state.trans_freq < 0 ? 0 : state.trans_freq;
                 break;
             case 'y':
-                trans_freq += 0.01;
+                state.trans_freq += 0.01;
                 break;
             case 'e':
-                trans_mag -= 0.01;
-                trans_mag = trans_mag < 0 ? 0 : trans_mag;
+                state.trans_mag -= 0.01;
+                state.trans_mag = state.trans_mag < 0 ? 0 : state.trans_mag;
                 break;
             case 'r':
-                trans_mag += 0.01;
+                state.trans_mag += 0.01;
                 break;
             case '+':
-                scale += 0.01;
+                state.scale += 0.01;
                 break;
             case '-':
-                scale -= 0.01;
-                scale = scale < 0 ? 0 : scale;
+                state.scale -= 0.01;
+                state.scale = state.scale < 0 ? 0 : state.scale;
                 break;
         }
+        scene_state.write(state);
     }
     stop = true;
     t.join();
-    std::cout << "\033[2J";
+    std::cout << "\033[2J\033[H";
+    std::cout.flush();
+    print_stats("frame time", scheduler.frame_times());
+    print_stats("jitter", scheduler.jitter());
+    printf("%llu frames skipped\n", (unsigned long long)scheduler.skipped_frames());
     return 0;
 }
\ No newline at end of file
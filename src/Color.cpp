@@ -0,0 +1,63 @@
+#include "Color.hpp"
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#define MAX(x,y) ((x)>(y)?(x):(y))
+
+Color::Color() :
+    r(255), g(255), b(255) {}
+
+Color::Color(uint8_t r, uint8_t g, uint8_t b) :
+    r(r), g(g), b(b) {}
+
+Color Color::operator*(float intensity) const {
+    intensity = MAX(0.f, MIN(1.f, intensity));
+    return Color(r * intensity + 0.5f, g * intensity + 0.5f, b * intensity + 0.5f);
+}
+
+bool Color::operator==(const Color& color) const {
+    return r == color.r && g == color.g && b == color.b;
+}
+
+bool Color::operator!=(const Color& color) const {
+    return !(*this == color);
+}
+
+static int cube_level(int c) {
+    return c < 48 ? 0 : c < 115 ? 1 : (c - 35) / 40;
+}
+
+static int cube_value(int level) {
+    return level ? 55 + level * 40 : 0;
+}
+
+static int squared_distance(int r0, int g0, int b0, int r1, int g1, int b1) {
+    return (r0-r1)*(r0-r1) + (g0-g1)*(g0-g1) + (b0-b1)*(b0-b1);
+}
+
+// Nearest xterm-256 index, choosing between the 6x6x6 cube and the gray ramp
+uint32_t Color::quantize256() const {
+    int cr = cube_level(r), cg = cube_level(g), cb = cube_level(b);
+    int cube_dist = squared_distance(r, g, b, cube_value(cr), cube_value(cg), cube_value(cb));
+
+    int average = (r + g + b) / 3;
+    int gray = average > 238 ? 23 : MAX(0, (average - 3) / 10);
+    int gray_value = 8 + gray * 10;
+    int gray_dist = squared_distance(r, g, b, gray_value, gray_value, gray_value);
+
+    if (gray_dist < cube_dist)
+        return 232 + gray;
+    return 16 + 36 * cr + 6 * cg + cb;
+}
+
+// Snaps each channel to one of `levels` evenly spaced values and packs the result as 0xRRGGBB
+uint32_t Color::quantize(int levels) const {
+    if (levels < 2 || levels >= 256)
+        return (r << 16) | (g << 8) | b;
+    int steps = levels - 1;
+    int qr = (r * steps + 127) / 255 * 255 / steps;
+    int qg = (g * steps + 127) / 255 * 255 / steps;
+    int qb = (b * steps + 127) / 255 * 255 / steps;
+    return (qr << 16) | (qg << 8) | qb;
+}
+
+#undef MIN
+#undef MAX
\ No newline at end of file
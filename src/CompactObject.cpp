@@ -0,0 +1,146 @@
+#include "CompactObject.hpp"
+#include "JobSystem.hpp"
+#include <array>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#define ABS(x) ((x)>0?(x):(-(x)))
+#define QUANT_MAX 65535.f
+#define SNORM_MAX 32767.f
+#define TRANSFORM_GRAIN 1024
+
+static float sign_not_zero(float x) {
+    return x >= 0 ? 1.f : -1.f;
+}
+
+// Octahedral mapping: project onto |x|+|y|+|z| = 1 and fold the lower hemisphere over the upper one
+static void encode_normal(const Vector4& n, int16_t out[2]) {
+    float l1 = ABS(n[0]) + ABS(n[1]) + ABS(n[2]);
+    float u = l1 > 0 ? n[0] / l1 : 0;
+    float v = l1 > 0 ? n[1] / l1 : 0;
+    if (n[2] < 0) {
+        float fu = (1 - ABS(v)) * sign_not_zero(u);
+        float fv = (1 - ABS(u)) * sign_not_zero(v);
+        u = fu;
+        v = fv;
+    }
+    out[0] = std::lround(MAX(-1.f, MIN(1.f, u)) * SNORM_MAX);
+    out[1] = std::lround(MAX(-1.f, MIN(1.f, v)) * SNORM_MAX);
+}
+
+static Vector4 decode_normal(const int16_t in[2]) {
+    float u = in[0] / SNORM_MAX;
+    float v = in[1] / SNORM_MAX;
+    float z = 1 - ABS(u) - ABS(v);
+    if (z < 0) {
+        float fu = (1 - ABS(v)) * sign_not_zero(u);
+        float fv = (1 - ABS(u)) * sign_not_zero(v);
+        u = fu;
+        v = fv;
+    }
+    return Vector4(u, v, z, 0).normalize();
+}
+
+CompactObject::CompactObject() {}
+
+CompactObject::CompactObject(const Object& obj) :
+    _color(obj.color()) {
+    const std::vector<Triangle>& mesh = obj.triangles();
+    const std::vector<Vector4>& normals = obj.normals();
+
+    Vector4 lo(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), 1);
+    Vector4 hi = -lo;
+    for (const Triangle& tri : mesh) {
+        for (int v = 0; v < 3; v++) {
+            for (int c = 0; c < 3; c++) {
+                lo[c] = MIN(lo[c], tri[v][c]);
+                hi[c] = MAX(hi[c], tri[v][c]);
+            }
+        }
+    }
+    if (mesh.empty())
+        lo = hi = Vector4(0, 0, 0, 1);
+    origin = Vector4(lo[0], lo[1], lo[2], 1);
+    extent = Vector4(hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2], 0);
+
+    // Vertices that land on the same grid point are shared
+    std::unordered_map<uint64_t, uint32_t> welded;
+    indices.reserve(mesh.size() * 3);
+    packed_normals.resize(mesh.size() * 2);
+    for (size_t i = 0; i < mesh.size(); i++) {
+        for (int v = 0; v < 3; v++) {
+            uint16_t q[3];
+            for (int c = 0; c < 3; c++)
+                q[c] = extent[c] > 0 ? std::lround((mesh[i][v][c] - origin[c]) / extent[c] * QUANT_MAX) : 0;
+            uint64_t key = ((uint64_t)q[0] << 32) | ((uint64_t)q[1] << 16) | q[2];
+            auto it = welded.emplace(key, positions.size() / 3);
+            if (it.second)
+                positions.insert(positions.end(), q, q + 3);
+            indices.push_back(it.first->second);
+        }
+        encode_normal(normals[i], &packed_normals[i * 2]);
+    }
+    positions.shrink_to_fit();
+}
+
+size_t CompactObject::vertex_count() const {
+    return positions.size() / 3;
+}
+
+size_t CompactObject::triangle_count() const {
+    return indices.size() / 3;
+}
+
+size_t CompactObject::bytes() const {
+    return positions.size() * sizeof(uint16_t) + indices.size() * sizeof(uint32_t) + packed_normals.size() * sizeof(int16_t);
+}
+
+Color CompactObject::color() const {
+    return _color;
+}
+
+const uint32_t* CompactObject::triangle(int idx) const {
+    return &indices[idx * 3];
+}
+
+Vector4 CompactObject::normal(int idx) const {
+    return decode_normal(&packed_normals[idx * 2]);
+}
+
+Matrix4 CompactObject::dequantization() const {
+    return Matrix4::Translation(origin[0], origin[1], origin[2]) * Matrix4::Scale(extent[0] / QUANT_MAX, extent[1] / QUANT_MAX, extent[2] / QUANT_MAX);
+}
+
+// Transforms every vertex once, straight from the integer grid (fold dequantization() into M),
+// and applies the perspective divide. The loop body is plain float arithmetic so it vectorizes.
+void CompactObject::transform(const Matrix4& M, std::vector<Vector4>& out) const {
+    float m[16];
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            m[c + r*4] = M[std::pair<int, int>(r, c)];
+
+    out.resize(vertex_count());
+    JobSystem::global().parallel_for(0, vertex_count(), TRANSFORM_GRAIN, [&](int begin, int end) {
+        const uint16_t* q = &positions[begin * 3];
+        for (int i = begin; i < end; i++, q += 3) {
+            float x = q[0], y = q[1], z = q[2];
+            float w = m[12]*x + m[13]*y + m[14]*z + m[15];
+            float inv = 1 / w;
+            out[i] = Vector4(
+                (m[0]*x + m[1]*y + m[2]*z + m[3]) * inv,
+                (m[4]*x + m[5]*y + m[6]*z + m[7]) * inv,
+                (m[8]*x + m[9]*y + m[10]*z + m[11]) * inv,
+                1
+            );
+        }
+    });
+}
+
+#undef MAX
+#undef MIN
+#undef ABS
+#undef QUANT_MAX
+#undef SNORM_MAX
+#undef TRANSFORM_GRAIN
\ No newline at end of file
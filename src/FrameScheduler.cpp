@@ -0,0 +1,125 @@
+#include "FrameScheduler.hpp"
+#include <cerrno>
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#define SUB_BUCKET_BITS 6
+#define HALF_BUCKET (1 << (SUB_BUCKET_BITS - 1))
+#define NSEC_PER_SEC 1000000000LL
+
+static int64_t to_ns(const struct timespec& t) {
+    return t.tv_sec * NSEC_PER_SEC + t.tv_nsec;
+}
+
+static struct timespec from_ns(int64_t ns) {
+    struct timespec t;
+    t.tv_sec = ns / NSEC_PER_SEC;
+    t.tv_nsec = ns % NSEC_PER_SEC;
+    return t;
+}
+
+static struct timespec now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t;
+}
+
+// Log-linear buckets: exact below 2^SUB_BUCKET_BITS, then HALF_BUCKET linear steps per power of two (about 3% error)
+Histogram::Histogram() :
+    buckets(64 * HALF_BUCKET, 0), count(0), max_value(0) {}
+
+int Histogram::bucket(uint64_t value) {
+    if (value < 2 * HALF_BUCKET)
+        return value;
+    int shift = 63 - __builtin_clzll(value) - (SUB_BUCKET_BITS - 1);
+    return shift * HALF_BUCKET + (value >> shift);
+}
+
+uint64_t Histogram::bucket_value(int idx) {
+    if (idx < 2 * HALF_BUCKET)
+        return idx;
+    int shift = idx / HALF_BUCKET - 1;
+    return (uint64_t)(idx % HALF_BUCKET + HALF_BUCKET) << shift;
+}
+
+void Histogram::record(uint64_t value) {
+    buckets[bucket(value)]++;
+    count++;
+    max_value = MAX(max_value, value);
+}
+
+void Histogram::reset() {
+    buckets.assign(buckets.size(), 0);
+    count = 0;
+    max_value = 0;
+}
+
+uint64_t Histogram::percentile(double q) const {
+    if (!count)
+        return 0;
+    uint64_t rank = q * count;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen > rank)
+            return bucket_value(i) < max_value ? bucket_value(i) : max_value;
+    }
+    return max_value;
+}
+
+uint64_t Histogram::max() const {
+    return max_value;
+}
+
+uint64_t Histogram::samples() const {
+    return count;
+}
+
+FrameScheduler::FrameScheduler(int fps) :
+    skipped(0) {
+    origin = deadline = frame_start = now();
+    set_fps(fps);
+}
+
+void FrameScheduler::set_fps(int fps) {
+    period = NSEC_PER_SEC / MAX(1, fps);
+}
+
+double FrameScheduler::elapsed() const {
+    return (to_ns(now()) - to_ns(origin)) / (double)NSEC_PER_SEC;
+}
+
+// Sleeps until the next absolute deadline. Deadlines already missed are skipped rather than
+// rendered back to back, so a slow frame never makes the following ones run early.
+void FrameScheduler::wait() {
+    int64_t current = to_ns(now());
+    frame_hist.record(current - to_ns(frame_start));
+
+    int64_t next = to_ns(deadline) + period;
+    if (current >= next) {
+        int64_t missed = (current - next) / period + 1;
+        skipped += missed;
+        next += missed * period;
+    }
+    deadline = from_ns(next);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+        ;
+
+    frame_start = now();
+    jitter_hist.record(MAX(0, to_ns(frame_start) - next));
+}
+
+const Histogram& FrameScheduler::frame_times() const {
+    return frame_hist;
+}
+
+const Histogram& FrameScheduler::jitter() const {
+    return jitter_hist;
+}
+
+uint64_t FrameScheduler::skipped_frames() const {
+    return skipped;
+}
+
+#undef MAX
+#undef SUB_BUCKET_BITS
+#undef HALF_BUCKET
+#undef NSEC_PER_SEC
\ No newline at end of file
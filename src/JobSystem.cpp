@@ -0,0 +1,179 @@
+#include "JobSystem.hpp"
+#define MAX(x,y) ((x)>(y)?(x):(y))
+
+// Worker threads own queues 1..n, every other thread shares queue 0
+static thread_local const JobSystem* current_system = nullptr;
+static thread_local int current_queue = 0;
+
+static std::mutex global_lock;
+static int global_workers = -1;
+static bool global_started = false;
+
+JobSystem& JobSystem::global() {
+    static JobSystem jobs([] {
+        std::lock_guard<std::mutex> guard(global_lock);
+        global_started = true;
+        return global_workers >= 0 ? global_workers : MAX(0, (int)std::thread::hardware_concurrency() - 1);
+    }());
+    return jobs;
+}
+
+bool JobSystem::set_global_workers(int workers) {
+    std::lock_guard<std::mutex> guard(global_lock);
+    if (global_started)
+        return false;
+    global_workers = MAX(0, workers);
+    return true;
+}
+
+JobSystem::JobSystem(int workers) :
+    queued(0), stopping(false) {
+    for (int i = 0; i <= workers; i++)
+        queues.emplace_back(new Worker());
+    for (int i = 1; i <= workers; i++)
+        threads.emplace_back(&JobSystem::worker_loop, this, i);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : threads)
+        t.join();
+}
+
+int JobSystem::queue_index() const {
+    return current_system == this ? current_queue : 0;
+}
+
+bool JobSystem::pop(int idx, Task& task) {
+    Worker& worker = *queues[idx];
+    std::lock_guard<std::mutex> guard(worker.lock);
+    if (worker.tasks.empty())
+        return false;
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+// Thieves take the oldest task, which for split_for is the largest remaining range
+bool JobSystem::steal(int idx, Task& task) {
+    int n = queues.size();
+    for (int i = 1; i < n; i++) {
+        Worker& victim = *queues[(idx + i) % n];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.tasks.empty())
+            continue;
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::run_one(int idx) {
+    Task task;
+    if (!pop(idx, task) && !steal(idx, task))
+        return false;
+    queued--;
+    task.fn();
+    task.pending->fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void JobSystem::worker_loop(int idx) {
+    current_system = this;
+    current_queue = idx;
+    while (true) {
+        if (run_one(idx))
+            continue;
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        wake.wait(guard, [this] { return stopping || queued > 0; });
+        if (stopping)
+            return;
+    }
+}
+
+void JobSystem::submit(std::function<void()> fn, std::atomic<int>& pending) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    Worker& worker = *queues[queue_index()];
+    {
+        std::lock_guard<std::mutex> guard(worker.lock);
+        worker.tasks.push_back(Task{std::move(fn), &pending});
+    }
+    queued++;
+    if (!threads.empty()) {
+        { std::lock_guard<std::mutex> guard(sleep_lock); }
+        wake.notify_one();
+    }
+}
+
+// The waiting thread keeps executing queued work instead of blocking, so nested waits cannot deadlock
+void JobSystem::wait(std::atomic<int>& pending) {
+    int idx = queue_index();
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (!run_one(idx))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::split_for(int begin, int end, int grain, const std::function<void(int, int)>& body, std::atomic<int>& pending) {
+    while (end - begin > grain) {
+        int mid = begin + (end - begin) / 2;
+        submit([this, mid, end, grain, &body, &pending] { split_for(mid, end, grain, body, pending); }, pending);
+        end = mid;
+    }
+    body(begin, end);
+}
+
+void JobSystem::parallel_for(int begin, int end, int grain, const std::function<void(int, int)>& body) {
+    if (end <= begin)
+        return;
+    grain = MAX(1, grain);
+    if (end - begin <= grain || threads.empty()) {
+        body(begin, end);
+        return;
+    }
+    std::atomic<int> pending(0);
+    split_for(begin, end, grain, body, pending);
+    wait(pending);
+}
+
+int JobSystem::concurrency() const {
+    return threads.size() + 1;
+}
+
+int TaskGraph::add(std::function<void()> fn) {
+    nodes.push_back(Node());
+    nodes.back().fn = std::move(fn);
+    return nodes.size() - 1;
+}
+
+void TaskGraph::precede(int before, int after) {
+    nodes[before].successors.push_back(after);
+    nodes[after].dependencies++;
+}
+
+void TaskGraph::run(JobSystem& jobs) {
+    std::unique_ptr<std::atomic<int>[]> remaining(new std::atomic<int>[nodes.size()]);
+    for (size_t i = 0; i < nodes.size(); i++)
+        remaining[i] = nodes[i].dependencies;
+
+    std::atomic<int> pending(0);
+    std::function<void(int)> launch = [&](int idx) {
+        jobs.submit([&, idx] {
+            nodes[idx].fn();
+            for (int next : nodes[idx].successors)
+                if (remaining[next].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    launch(next);
+        }, pending);
+    };
+    for (size_t i = 0; i < nodes.size(); i++)
+        if (!nodes[i].dependencies)
+            launch(i);
+    jobs.wait(pending);
+}
+
+#undef MAX
@@ -280,6 +280,30 @@ Vector4 Matrix4::operator*(const Vector4& vec) const {
     return Vector4(ret);
 }
 
+// Inverse transpose of the upper 3x3 block, i.e. its cofactor matrix over the determinant
+Matrix4 Matrix4::normal_matrix() const {
+    const float* m = this->mat;
+    float c00 = m[5]*m[10] - m[6]*m[9];
+    float c01 = m[6]*m[8] - m[4]*m[10];
+    float c02 = m[4]*m[9] - m[5]*m[8];
+    float c10 = m[2]*m[9] - m[1]*m[10];
+    float c11 = m[0]*m[10] - m[2]*m[8];
+    float c12 = m[1]*m[8] - m[0]*m[9];
+    float c20 = m[1]*m[6] - m[2]*m[5];
+    float c21 = m[2]*m[4] - m[0]*m[6];
+    float c22 = m[0]*m[5] - m[1]*m[4];
+    float det = m[0]*c00 + m[1]*c01 + m[2]*c02;
+    if (det == 0)
+        return Matrix4::Identity;
+    float inv = 1 / det;
+    return Matrix4(
+        c00*inv,    c01*inv,    c02*inv,    0.f,
+        c10*inv,    c11*inv,    c12*inv,    0.f,
+        c20*inv,    c21*inv,    c22*inv,    0.f,
+        0.f,        0.f,        0.f,        1.f
+    );
+}
+
 std::ostream& operator<<(std::ostream& os, const Matrix4 mat) {
     os << '[' << mat[std::pair<int, int>(0, 0)] << ", " << mat[std::pair<int, int>(0, 1)] << ", " << mat[std::pair<int, int>(0, 2)] << ", " << mat[std::pair<int, int>(0, 3)] << ", \n"
        << ' ' << mat[std::pair<int, int>(1, 0)] << ", " << mat[std::pair<int, int>(1, 1)] << ", " << mat[std::pair<int, int>(1, 2)] << ", " << mat[std::pair<int, int>(1, 3)] << ", \n"
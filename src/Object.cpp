@@ -1,18 +1,103 @@
 #include "Object.hpp"
+#include "JobSystem.hpp"
+#include "Primitives.hpp"
 #include <limits>
 #include <cmath>
+#include <deque>
+#include <mutex>
 #define MAX(x,y) ((x)>(y)?(x):(y))
 #define MIN(x,y) ((x)<(y)?(x):(y))
+#define TRANSFORM_GRAIN 256
 
 Object::Object() {}
 
-Object::Object(std::list<Triangle>& mesh) :
+Object::Object(const std::vector<Triangle>& mesh) :
     mesh(mesh) {}
 
-std::list<Triangle> Object::triangles() const {
+Object::Object(const std::vector<Triangle>& mesh, const Color& color) :
+    mesh(mesh), _color(color) {}
+
+Object::Object(std::vector<Triangle>&& mesh) :
+    mesh(std::move(mesh)) {}
+
+Object::Object(std::vector<Triangle>&& mesh, const Color& color) :
+    mesh(std::move(mesh)), _color(color) {}
+
+const std::vector<Triangle>& Object::triangles() const {
     return this->mesh;
 }
 
+Object::Object(const Object& obj) :
+    mesh(obj.mesh), _color(obj._color) {
+    if (obj.setup_valid.load(std::memory_order_acquire)) {
+        _normals = obj._normals;
+        setup_valid.store(true, std::memory_order_relaxed);
+    }
+}
+
+// The source is being given up, so nobody else can be filling its cache
+Object::Object(Object&& obj) :
+    mesh(std::move(obj.mesh)), _color(obj._color) {
+    if (obj.setup_valid.load(std::memory_order_relaxed)) {
+        _normals = std::move(obj._normals);
+        setup_valid.store(true, std::memory_order_relaxed);
+    }
+    obj.setup_valid.store(false, std::memory_order_relaxed);
+}
+
+Object& Object::operator=(const Object& obj) {
+    if (this == &obj)
+        return *this;
+    mesh = obj.mesh;
+    _color = obj._color;
+    bool valid = obj.setup_valid.load(std::memory_order_acquire);
+    if (valid)
+        _normals = obj._normals;
+    setup_valid.store(valid, std::memory_order_release);
+    return *this;
+}
+
+Object& Object::operator=(Object&& obj) {
+    if (this == &obj)
+        return *this;
+    mesh = std::move(obj.mesh);
+    _color = obj._color;
+    bool valid = obj.setup_valid.load(std::memory_order_relaxed);
+    if (valid)
+        _normals = std::move(obj._normals);
+    setup_valid.store(valid, std::memory_order_release);
+    obj.setup_valid.store(false, std::memory_order_relaxed);
+    return *this;
+}
+
+// Face normals are built once, on first use, and reused until the geometry changes. The lock makes
+// the first use safe from any number of threads, so a const Object can be shared freely.
+const std::vector<Vector4>& Object::normals() const {
+    if (setup_valid.load(std::memory_order_acquire))
+        return _normals;
+    std::lock_guard<std::mutex> guard(setup_lock);
+    if (!setup_valid.load(std::memory_order_relaxed)) {
+        _normals.resize(mesh.size());
+        for (size_t i = 0; i < mesh.size(); i++)
+            _normals[i] = mesh[i].normal();
+        setup_valid.store(true, std::memory_order_release);
+    }
+    return _normals;
+}
+
+// Only called on an object nobody else can see yet, before its geometry is changed
+void Object::invalidate() {
+    setup_valid.store(false, std::memory_order_relaxed);
+}
+
+Color Object::color() const {
+    return this->_color;
+}
+
+void Object::set_color(const Color& color) {
+    this->_color = color;
+}
+
 void Object::bounding(float& x0, float& y0, float& x1, float& y1) const {
     x0 = std::numeric_limits<float>::infinity();
     y0 = std::numeric_limits<float>::infinity();
@@ -30,10 +115,14 @@ void Object::bounding(float& x0, float& y0, float& x1, float& y1) const {
 }
 
 Object operator*(const Matrix4& proj, const Object& obj) {
-    std::list<Triangle> mesh(obj.mesh);
-    for (Triangle& tri : mesh)
-        tri = proj * tri;
-    return Object(mesh);
+    Object ret(obj.mesh, obj._color);
+    std::vector<Triangle>& mesh = ret.mesh;
+    ret.invalidate();
+    JobSystem::global().parallel_for(0, mesh.size(), TRANSFORM_GRAIN, [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+            mesh[i] = proj * mesh[i];
+    });
+    return ret;
 }
 
 std::ostream& operator<<(std::ostream& os, const Object& obj) {
@@ -52,135 +141,41 @@ RectangularMesh::RectangularMesh(Vector4 vert0, Vector4 vert1, Vector4 vert2, Ve
     mesh.push_back(Triangle(vert0, vert2, vert3));
 }
 
+template <size_t V, size_t F>
+static void build(std::vector<Triangle>& mesh, const Primitives::Vertex (&vertices)[V], const Primitives::Face (&faces)[F]) {
+    mesh.reserve(F);
+    for (const Primitives::Face& f : faces) {
+        const Primitives::Vertex& v0 = vertices[f.v0];
+        const Primitives::Vertex& v1 = vertices[f.v1];
+        const Primitives::Vertex& v2 = vertices[f.v2];
+        mesh.push_back(Triangle(Vector4(v0.x, v0.y, v0.z, 1), Vector4(v1.x, v1.y, v1.z, 1), Vector4(v2.x, v2.y, v2.z, 1)));
+    }
+}
+
 CubeMesh::CubeMesh() {
-    std::list<Triangle> tris;
-    RectangularMesh rect = RectangularMesh(
-        Vector4(-0.5, -0.5, -0.5,  1.0),
-        Vector4(-0.5,  0.5, -0.5,  1.0),
-        Vector4( 0.5,  0.5, -0.5,  1.0),
-        Vector4( 0.5, -0.5, -0.5,  1.0)
-    );
-    tris = rect.triangles();
-    mesh.insert(mesh.end(), tris.begin(), tris.end());
-    rect = RectangularMesh(
-        Vector4(-0.5, -0.5,  0.5,  1.0),
-        Vector4( 0.5, -0.5,  0.5,  1.0),
-        Vector4( 0.5,  0.5,  0.5,  1.0),
-        Vector4(-0.5,  0.5,  0.5,  1.0)
-    );
-    tris = rect.triangles();
-    mesh.insert(mesh.end(), tris.begin(), tris.end());
-    rect = RectangularMesh(
-        Vector4(-0.5, -0.5, -0.5,  1.0),
-        Vector4(-0.5, -0.5,  0.5,  1.0),
-        Vector4(-0.5,  0.5,  0.5,  1.0),
-        Vector4(-0.5,  0.5, -0.5,  1.0)
-    );
-    tris = rect.triangles();
-    mesh.insert(mesh.end(), tris.begin(), tris.end());
-    rect = RectangularMesh(
-        Vector4( 0.5, -0.5, -0.5,  1.0),
-        Vector4( 0.5,  0.5, -0.5,  1.0),
-        Vector4( 0.5,  0.5,  0.5,  1.0),
-        Vector4( 0.5, -0.5,  0.5,  1.0)
-    );
-    tris = rect.triangles();
-    mesh.insert(mesh.end(), tris.begin(), tris.end());
-    rect = RectangularMesh(
-        Vector4(-0.5, -0.5, -0.5,  1.0),
-        Vector4( 0.5, -0.5, -0.5,  1.0),
-        Vector4( 0.5, -0.5,  0.5,  1.0),
-        Vector4(-0.5, -0.5,  0.5,  1.0)
-    );
-    tris = rect.triangles();
-    mesh.insert(mesh.end(), tris.begin(), tris.end());
-    rect = RectangularMesh(
-        Vector4(-0.5,  0.5, -0.5,  1.0),
-        Vector4(-0.5,  0.5,  0.5,  1.0),
-        Vector4( 0.5,  0.5,  0.5,  1.0),
-        Vector4( 0.5,  0.5, -0.5,  1.0)
-    );
-    tris = rect.triangles();
-    mesh.insert(mesh.end(), tris.begin(), tris.end());
+    build(mesh, Primitives::cube_vertices, Primitives::cube_faces);
 }
 
 TetrahedronMesh::TetrahedronMesh() {
-    mesh.push_back(Triangle(
-        Vector4(std::sqrt(8), 0, -1, 1),
-        Vector4(-std::sqrt(2), std::sqrt(6), -1, 1),
-        Vector4(-std::sqrt(2), -std::sqrt(6), -1, 1)
-    ));
-    mesh.push_back(Triangle(
-        Vector4(std::sqrt(8), 0, -1, 1),
-        Vector4(0, 0, 3, 1),
-        Vector4(-std::sqrt(2), -std::sqrt(6), -1, 1)
-    ));
-    mesh.push_back(Triangle(
-        Vector4(std::sqrt(8), 0, -1, 1),
-        Vector4(-std::sqrt(2), std::sqrt(6), -1, 1),
-        Vector4(0, 0, 3, 1)
-    ));
-    mesh.push_back(Triangle(
-        Vector4(0, 0, 3, 1),
-        Vector4(-std::sqrt(2), std::sqrt(6), -1, 1),
-        Vector4(-std::sqrt(2), -std::sqrt(6), -1, 1)
-    ));
+    build(mesh, Primitives::tetrahedron_vertices, Primitives::tetrahedron_faces);
 }
 
 IcosahedronMesh::IcosahedronMesh() {
-    float t = (1.0 + std::sqrt(5)) / 2;
-    Vector4 vertices[12] = {
-        Vector4(-1,  t,  0, 1),
-        Vector4( 1,  t,  0, 1),
-        Vector4(-1, -t,  0, 1),
-        Vector4( 1, -t,  0, 1),
-
-        Vector4( 0, -1,  t, 1),
-        Vector4( 0,  1,  t, 1),
-        Vector4( 0, -1, -t, 1),
-        Vector4( 0,  1, -t, 1),
-
-        Vector4( t,  0, -1, 1),
-        Vector4( t,  0,  1, 1),
-        Vector4(-t,  0, -1, 1),
-        Vector4(-t,  0,  1, 1)
-    };
-
-    int indices[20][3] = {
-        { 0, 11,  5},
-        { 0,  5,  1},
-        { 0,  1,  7},
-        { 0,  7, 10},
-        { 0, 10, 11},
-
-        { 1,  5,  9},
-        { 5, 11,  4},
-        {11, 10,  2},
-        {10,  7,  6},
-        { 7,  1,  8},
-
-        { 3,  9,  4},
-        { 3,  4,  2},
-        { 3,  2,  6},
-        { 3,  6,  8},
-        { 3,  8,  9},
-
-        { 4,  9,  5},
-        { 2,  4, 11},
-        { 6,  2, 10},
-        { 8,  6,  7},
-        { 9,  8,  1}
-    };
-
-    for (int i = 0; i < 20; i++) {
-        mesh.push_back(Triangle(vertices[indices[i][0]], vertices[indices[i][1]], vertices[indices[i][2]]));
-    }
+    build(mesh, Primitives::icosahedron_vertices, Primitives::icosahedron_faces);
 }
 
-SphereMesh::SphereMesh(int res) {
-    std::list<Triangle> tris = IcosahedronMesh().triangles();;
-    while (res--) {
-        mesh.clear();
+// Subdivision levels are computed once, each from the one before, and shared by every SphereMesh.
+// A deque keeps references to finished levels valid while later ones are appended.
+static const std::vector<Triangle>& sphere_level(int res) {
+    static std::mutex lock;
+    static std::deque<std::vector<Triangle>> levels;
+    std::lock_guard<std::mutex> guard(lock);
+    if (levels.empty())
+        levels.push_back(IcosahedronMesh().triangles());
+    while ((int)levels.size() <= res) {
+        const std::vector<Triangle>& tris = levels.back();
+        std::vector<Triangle> next;
+        next.reserve(tris.size());
         for (const Triangle& tri : tris) {
             Vector4 mid0 = (tri[0] + tri[1]) / 2;
             Vector4 mid1 = (tri[1] + tri[2]) / 2;
@@ -190,14 +185,21 @@ SphereMesh::SphereMesh(int res) {
             mid0 = mid0 * scale_vec;
             mid1 = mid1 * scale_vec;
             mid2 = mid2 * scale_vec;
-            // mesh.push_back(Triangle(tri[0], mid0, mid2));
-            // mesh.push_back(Triangle(tri[1], mid1, mid0));
-            // mesh.push_back(Triangle(tri[2], mid2, mid1));
-            mesh.push_back(Triangle(mid0, mid1, mid2));
+            // next.push_back(Triangle(tri[0], mid0, mid2));
+            // next.push_back(Triangle(tri[1], mid1, mid0));
+            // next.push_back(Triangle(tri[2], mid2, mid1));
+            next.push_back(Triangle(mid0, mid1, mid2));
         }
-        tris = mesh;
+        levels.push_back(std::move(next));
     }
+    return levels[res];
+}
+
+SphereMesh::SphereMesh(int res) {
+    if (res > 0)
+        mesh = sphere_level(res);
 }
 
 #undef MAX
-#undef MIN
\ No newline at end of file
+#undef MIN
+#undef TRANSFORM_GRAIN
\ No newline at end of file
@@ -1,67 +1,365 @@
 #include "Renderer.hpp"
+#include "JobSystem.hpp"
 #include <memory.h>
 #include <iostream>
 #include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
 #define MAX(x,y) ((x)>(y)?(x):(y))
 #define MIN(x,y) ((x)<(y)?(x):(y))
 #define ABS(x) ((x)>0?(x):(-(x)))
+#define SETUP_GRAIN 128
+#define SETUP_BATCH 4096
+#define TILE_WIDTH 16
+#define TILE_HEIGHT 8
+#define CACHE_LINE 64
 
 Renderer::Renderer(int width, int height, float zfar, float znear) :
-    _width(width), _height(height), zfar(zfar), znear(znear), dirty_x0(width/2), dirty_y0(height/2), dirty_x1(-width/2), dirty_y1(-height/2) {
-    this->frame_buffer = new char[width*height];
-    this->depth_buffer = new float[width*height];
+    _width(width), _height(height), zfar(zfar), znear(znear), dirty_x0(width/2), dirty_y0(height/2), dirty_x1(-width/2), dirty_y1(-height/2),
+    repaint(true), owns_frame(true), owns_depth(true) {
+    this->frame_buffer = nullptr;
+    this->depth_buffer = nullptr;
+    this->depth16_buffer = nullptr;
+    this->color_buffer = nullptr;
+    this->frame_storage = this->depth_storage = this->color_storage = nullptr;
+    this->frame_capacity = this->depth_capacity = this->color_capacity = 0;
+    this->frame_color_mode = ColorMode::None;
+    // NDC depth of the far plane under Matrix4::Perspective; the near plane always lies 2 above it
+    this->depth16_far = (zfar + 3 * znear) / (zfar - znear);
+    Renderer::allocate(DepthFormat::Float32);
+    this->tile_cleared.assign(tile_count(), 0);
 }
 
 Renderer::~Renderer() {
-    delete [] this->frame_buffer;
-    delete [] this->depth_buffer;
+    free(this->frame_storage);
+    free(this->depth_storage);
+    free(this->color_storage);
 }
 
+// Makes storage hold at least `bytes`, starting on a cache line. Contents are not kept, since every
+// caller resets the tiles afterwards, and storage never shrinks.
+void Renderer::reserve(void*& storage, size_t& capacity, size_t bytes) {
+    if (bytes <= capacity)
+        return;
+    bytes = (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    void* grown = aligned_alloc(CACHE_LINE, bytes);
+    if (!grown)
+        throw std::bad_alloc();
+    free(storage);
+    storage = grown;
+    capacity = bytes;
+}
+
+// Row stride in elements that starts every row on a cache line
+static int padded_stride(int width, size_t element) {
+    int per_line = CACHE_LINE / element;
+    return (width + per_line - 1) / per_line * per_line;
+}
+
+// Points every buffer the caller has not bound at internal storage for the current size
+void Renderer::allocate(DepthFormat format) {
+    if (owns_frame) {
+        _frame_stride = padded_stride(_width, sizeof(char));
+        Renderer::reserve(frame_storage, frame_capacity, (size_t)_frame_stride * _height);
+        frame_buffer = (char*)frame_storage;
+    }
+    if (owns_depth) {
+        size_t element = format == DepthFormat::Unorm16 ? sizeof(uint16_t) : sizeof(float);
+        _depth_stride = padded_stride(_width, element);
+        Renderer::reserve(depth_storage, depth_capacity, (size_t)_depth_stride * _height * element);
+        depth_buffer = format == DepthFormat::Float32 ? (float*)depth_storage : nullptr;
+        depth16_buffer = format == DepthFormat::Unorm16 ? (uint16_t*)depth_storage : nullptr;
+    }
+    _color_stride = padded_stride(_width, sizeof(uint32_t));
+}
+
+// Clearing only marks every tile stale; a tile is wiped the first time it is drawn to or read
 void Renderer::clear() {
-    memset(this->frame_buffer, ' ', sizeof(char)*_width*_height);
-    for (int i = 0; i < _width*_height; i++)
-        this->depth_buffer[i] = 0;
+    tile_cleared.assign(tile_count(), 0);
+    // The color mode is latched per frame so toggling it mid-frame never mixes encodings
+    frame_color_mode = color_mode;
+    if (frame_color_mode != ColorMode::None) {
+        Renderer::reserve(color_storage, color_capacity, (size_t)_color_stride * _height * sizeof(uint32_t));
+        color_buffer = (uint32_t*)color_storage;
+    }
+}
+
+int Renderer::tile_count() const {
+    return ((_width + TILE_WIDTH - 1) / TILE_WIDTH) * ((_height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+}
+
+void Renderer::clear_tile(int tile) const {
+    int tiles_x = (_width + TILE_WIDTH - 1) / TILE_WIDTH;
+    int x0 = (tile % tiles_x) * TILE_WIDTH;
+    int y0 = (tile / tiles_x) * TILE_HEIGHT;
+    int x1 = MIN(x0 + TILE_WIDTH, _width);
+    int y1 = MIN(y0 + TILE_HEIGHT, _height);
+    for (int y = y0; y < y1; y++) {
+        memset(frame_buffer + x0 + y * _frame_stride, ' ', x1 - x0);
+        if (depth16_buffer)
+            memset(depth16_buffer + x0 + y * _depth_stride, 0, (x1 - x0) * sizeof(uint16_t));
+        else
+            memset(depth_buffer + x0 + y * _depth_stride, 0, (x1 - x0) * sizeof(float));
+    }
+    tile_cleared[tile] = 1;
+}
+
+// Wipes the stale tiles overlapping the buffer-space rectangle [x0, x1) x [y0, y1)
+void Renderer::resolve(int x0, int y0, int x1, int y1) const {
+    int tiles_x = (_width + TILE_WIDTH - 1) / TILE_WIDTH;
+    for (int ty = y0 / TILE_HEIGHT; ty * TILE_HEIGHT < y1; ty++)
+        for (int tx = x0 / TILE_WIDTH; tx * TILE_WIDTH < x1; tx++)
+            if (!tile_cleared[tx + ty * tiles_x])
+                clear_tile(tx + ty * tiles_x);
+}
+
+// Maps NDC depth linearly onto [1, 65535], from the far plane to the near one. NDC depth grows
+// with 1/distance, so the codes are already densest close to the viewer.
+uint16_t Renderer::encode_depth(float z) const {
+    float n = MAX(0.f, MIN(1.f, (z - depth16_far) * 0.5f));
+    return 1 + (uint16_t)(n * 65534 + 0.5f);
+}
+
+void Renderer::set_depth_format(DepthFormat format) {
+    if (format != depth_format()) {
+        owns_depth = true;
+        Renderer::allocate(format);
+    }
+    tile_cleared.assign(tile_count(), 0);
+}
+
+DepthFormat Renderer::depth_format() const {
+    return depth16_buffer ? DepthFormat::Unorm16 : DepthFormat::Float32;
 }
 
 void Renderer::draw(const Matrix4& P, const Object& obj, float intensity) {
+    Renderer::draw(P, std::vector<const Object*>{&obj}, std::vector<Matrix4>{Matrix4::Identity}, intensity);
+}
+
+void Renderer::draw(const Matrix4& P, const Matrix4& M, const Object& obj, float intensity) {
+    Renderer::draw(P, std::vector<const Object*>{&obj}, std::vector<Matrix4>{M}, intensity);
+}
+
+void Renderer::draw(const Matrix4& P, const std::vector<const Object*>& objs, float intensity) {
+    Renderer::draw(P, objs, std::vector<Matrix4>(objs.size(), Matrix4::Identity), intensity);
+}
+
+void Renderer::draw(const Matrix4& P, const std::vector<const Object*>& objs, const std::vector<Matrix4>& models, float intensity) {
+    std::vector<int> offsets(1, 0);
+    std::vector<Matrix4> PM, N;
+    for (size_t o = 0; o < objs.size(); o++) {
+        offsets.push_back(offsets.back() + objs[o]->triangles().size());
+        objs[o]->normals();
+        PM.push_back(P * models[o]);
+        N.push_back(models[o].normal_matrix());
+    }
+
+    // Triangles go through setup, binning and rasterization in batches so memory stays bounded
+    for (int begin = 0; begin < offsets.back(); begin += SETUP_BATCH) {
+        int end = MIN(offsets.back(), begin + SETUP_BATCH);
+        Renderer::setup(objs, offsets, PM, N, begin, end);
+        Renderer::bin(P, intensity);
+    }
+}
+
+// Vertices are transformed once each, straight from their quantized form, then assembled into triangles
+void Renderer::draw(const Matrix4& P, const Matrix4& M, const CompactObject& obj, float intensity) {
+    Matrix4 N = M.normal_matrix();
+    obj.transform(P * M * obj.dequantization(), clip_vertices);
+    for (int begin = 0; begin < (int)obj.triangle_count(); begin += SETUP_BATCH) {
+        int end = MIN((int)obj.triangle_count(), begin + SETUP_BATCH);
+        Renderer::setup(obj, N, begin, end);
+        Renderer::bin(P, intensity);
+    }
+}
+
+// Projects the triangles [begin, end) of the concatenated objects and computes their scan rectangles.
+// Triangles of all objects share one index space so a single huge mesh and many small ones split evenly.
+// Lighting normals come from each object's cached normals and the model's normal matrix.
+void Renderer::setup(const std::vector<const Object*>& objs, const std::vector<int>& offsets,
+                     const std::vector<Matrix4>& PM, const std::vector<Matrix4>& N, int begin, int end) {
+    setups.resize(end - begin);
+
+    JobSystem::global().parallel_for(begin, end, SETUP_GRAIN, [&](int begin_, int end_) {
+        int o = std::upper_bound(offsets.begin(), offsets.end(), begin_) - offsets.begin() - 1;
+        for (int i = begin_; i < end_; i++) {
+            while (i >= offsets[o+1])
+                o++;
+            const Triangle& tri = objs[o]->triangles()[i - offsets[o]];
+            Setup& s = setups[i - begin];
+            s.color = objs[o]->color();
+            s.tri = PM[o] * tri;
+            s.normal = (N[o] * objs[o]->normals()[i - offsets[o]]).normalize();
+            Renderer::scan_bounds(s);
+        }
+    });
+}
+
+void Renderer::setup(const CompactObject& obj, const Matrix4& N, int begin, int end) {
+    setups.resize(end - begin);
+
+    JobSystem::global().parallel_for(begin, end, SETUP_GRAIN, [&](int begin_, int end_) {
+        for (int i = begin_; i < end_; i++) {
+            const uint32_t* idx = obj.triangle(i);
+            Setup& s = setups[i - begin];
+            s.color = obj.color();
+            s.tri = Triangle(clip_vertices[idx[0]], clip_vertices[idx[1]], clip_vertices[idx[2]]);
+            s.normal = (N * obj.normal(i)).normalize();
+            Renderer::scan_bounds(s);
+        }
+    });
+}
+
+void Renderer::scan_bounds(Setup& s) const {
     float scan_x0f, scan_y0f, scan_x1f, scan_y1f;
+    s.plane = s.tri.normal();
+    scan_x0f = scan_y0f = std::numeric_limits<float>::infinity();
+    scan_x1f = scan_y1f = -std::numeric_limits<float>::infinity();
+    s.tri.bounding(scan_x0f, scan_y0f, scan_x1f, scan_y1f);
+    // Cell x samples at (x+0.5)/width; one cell of slack absorbs rounding at the edges
+    s.x0 = MAX(-_width/2, std::floor(scan_x0f * _width - 0.5f));
+    s.y0 = MAX(-_height/2, std::floor(scan_y0f * _height - 0.5f));
+    s.x1 = MIN(_width/2, std::ceil(scan_x1f * _width - 0.5f) + 1);
+    s.y1 = MIN(_height/2, std::ceil(scan_y1f * _height - 0.5f) + 1);
+}
+
+// Sorts the set-up triangles into per-tile lists and rasterizes tile by tile. When the lists would
+// exceed bin_capacity entries, the triangles binned so far are rasterized and the bins restart empty.
+// Each tile keeps submission order, so the result matches drawing the triangles one after another.
+void Renderer::bin(const Matrix4& P, float intensity) {
+    int tiles_x = (_width + TILE_WIDTH - 1) / TILE_WIDTH;
+    int tiles_y = (_height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    int tiles = tiles_x * tiles_y;
+    size_t capacity = MAX((size_t)bin_capacity, (size_t)tiles);
+    int n = setups.size();
+
+    tile_ranges.resize(n);
+    for (int i = 0; i < n; i++) {
+        Setup& s = setups[i];
+        if (s.x0 >= s.x1 || s.y0 >= s.y1) {
+            tile_ranges[i] = {0, 0, 0, 0};
+            continue;
+        }
+        dirty_x0 = MIN(dirty_x0, s.x0);
+        dirty_y0 = MIN(dirty_y0, s.y0);
+        dirty_x1 = MAX(dirty_x1, s.x1);
+        dirty_y1 = MAX(dirty_y1, s.y1);
+        tile_ranges[i] = {
+            (s.x0 + _width/2) / TILE_WIDTH, (s.y0 + _height/2) / TILE_HEIGHT,
+            (s.x1 - 1 + _width/2) / TILE_WIDTH + 1, (s.y1 - 1 + _height/2) / TILE_HEIGHT + 1
+        };
+    }
+
+    for (int first = 0; first < n; ) {
+        int last = first;
+        size_t entries = 0;
+        bin_offsets.assign(tiles + 1, 0);
+        while (last < n) {
+            const TileRange& r = tile_ranges[last];
+            size_t count = (r.x1 - r.x0) * (r.y1 - r.y0);
+            if (entries + count > capacity)
+                break;
+            entries += count;
+            for (int ty = r.y0; ty < r.y1; ty++)
+                for (int tx = r.x0; tx < r.x1; tx++)
+                    bin_offsets[tx + ty * tiles_x + 1]++;
+            last++;
+        }
+        for (int t = 0; t < tiles; t++)
+            bin_offsets[t + 1] += bin_offsets[t];
+
+        bin_entries.resize(entries);
+        bin_fill.assign(bin_offsets.begin(), bin_offsets.end() - 1);
+        for (int i = first; i < last; i++) {
+            const TileRange& r = tile_ranges[i];
+            for (int ty = r.y0; ty < r.y1; ty++)
+                for (int tx = r.x0; tx < r.x1; tx++)
+                    bin_entries[bin_fill[tx + ty * tiles_x]++] = i;
+        }
+
+        JobSystem::global().parallel_for(0, tiles, 1, [&](int begin, int end) {
+            for (int t = begin; t < end; t++) {
+                if (bin_offsets[t] == bin_offsets[t + 1])
+                    continue;
+                if (!tile_cleared[t])
+                    Renderer::clear_tile(t);
+                int x0 = (t % tiles_x) * TILE_WIDTH - _width/2;
+                int y0 = (t / tiles_x) * TILE_HEIGHT - _height/2;
+                int x1 = MIN(x0 + TILE_WIDTH, _width - _width/2);
+                int y1 = MIN(y0 + TILE_HEIGHT, _height - _height/2);
+                for (uint32_t e = bin_offsets[t]; e < bin_offsets[t + 1]; e++)
+                    Renderer::rasterize(P, setups[bin_entries[e]], intensity, x0, y0, x1, y1);
+            }
+        });
+        first = last;
+    }
+}
 
-    for (const Triangle& tri : obj.triangles()) {
-        Triangle p_tri = P * tri;
-        p_tri.bounding(scan_x0f, scan_y0f, scan_x1f, scan_y1f);
-        int scan_x0 = MAX(-_width/2, std::floor(scan_x0f) * _width);
-        int scan_y0 = MAX(-_height/2, std::floor(scan_y0f) * _height);
-        int scan_x1 = MIN(_width/2, std::ceil(scan_x1f) * _width);
-        int scan_y1 = MIN(_height/2, std::ceil(scan_y1f) * _height);
-
-        dirty_x0 = MIN(dirty_x0, scan_x0);
-        dirty_y0 = MIN(dirty_y0, scan_y0);
-        dirty_x1 = MAX(dirty_x1, scan_x1);
-        dirty_y1 = MAX(dirty_y1, scan_y1);
-
-        float z;
-        Vector4 normal = tri.normal();
-        for (int x = scan_x0; x < scan_x1; x++) {
-            for (int y = scan_y0; y < scan_y1; y++) {
-                int pos = x+_width/2 + (y+_height/2) * _width;
-                if (p_tri.contains((x+0.5) / _width, (y+0.5) / _height, z) && z <= zfar && z >= znear && z > depth_buffer[pos]) {
-                    depth_buffer[pos] = z;
-                    z = (z - P[std::pair<int,int>(2,3)]) / P[std::pair<int,int>(2,2)];
-                    Vector4 frag(x+0.5, y+0.5, z, 0);
-                    frame_buffer[pos] = Renderer::intensity2char(Renderer::fragment2intensity(frag, normal, intensity));
-                }
+void Renderer::rasterize(const Matrix4& P, const Setup& s, float intensity, int x0, int y0, int x1, int y1) {
+    bool colored = frame_color_mode != ColorMode::None;
+    float z;
+    x0 = MAX(x0, s.x0);
+    y0 = MAX(y0, s.y0);
+    x1 = MIN(x1, s.x1);
+    y1 = MIN(y1, s.y1);
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            int pos = x+_width/2 + (y+_height/2) * _color_stride;
+            int dpos = x+_width/2 + (y+_height/2) * _depth_stride;
+            if (!(s.tri.contains((x+0.5) / _width, (y+0.5) / _height, s.plane, z) && z <= zfar && z >= znear))
+                continue;
+            if (depth16_buffer) {
+                uint16_t q = Renderer::encode_depth(z);
+                if (q <= depth16_buffer[dpos])
+                    continue;
+                depth16_buffer[dpos] = q;
             }
+            else {
+                if (!(z > depth_buffer[dpos]))
+                    continue;
+                depth_buffer[dpos] = z;
+            }
+            z = (z - P[std::pair<int,int>(2,3)]) / P[std::pair<int,int>(2,2)];
+            Vector4 frag(x+0.5, y+0.5, z, 0);
+            float shade = Renderer::fragment2intensity(frag, s.normal, intensity);
+            frame_buffer[x+_width/2 + (y+_height/2) * _frame_stride] = Renderer::intensity2char(shade);
+            if (colored)
+                color_buffer[pos] = Renderer::color2code(s.color * shade);
         }
     }
 }
 
 void Renderer::render() {
+    bool colored = frame_color_mode != ColorMode::None;
+    uint32_t current = UINT32_MAX;
+    // After a resize the whole screen is stale, not just what was drawn
+    if (repaint) {
+        dirty_x0 = -_width / 2;
+        dirty_y0 = -_height / 2;
+        dirty_x1 = _width - _width / 2;
+        dirty_y1 = _height - _height / 2;
+        repaint = false;
+    }
+    if (dirty_x0 < dirty_x1 && dirty_y0 < dirty_y1)
+        Renderer::resolve(dirty_x0 + _width/2, dirty_y0 + _height/2, dirty_x1 + _width/2, dirty_y1 + _height/2);
     std::cout << "\033[2J";
     for (int y = dirty_y0; y < dirty_y1; y++) {
         std::cout << "\033[" << (y + _height/2) << ';' << (dirty_x0 + _width/2) << 'H';
-        for (int x = dirty_x0; x < dirty_x1; x++)
-            std::cout << frame_buffer[x+_width/2 + (y+_height/2) * _width];
+        for (int x = dirty_x0; x < dirty_x1; x++) {
+            int pos = x+_width/2 + (y+_height/2) * _color_stride;
+            char c = frame_buffer[x+_width/2 + (y+_height/2) * _frame_stride];
+            // Blanks look the same in any color, so they never break a run
+            if (colored && c != ' ' && color_buffer[pos] != current) {
+                current = color_buffer[pos];
+                Renderer::emit_color(std::cout, current);
+            }
+            std::cout << c;
+        }
     }
+    if (current != UINT32_MAX)
+        std::cout << "\033[0m";
     std::cout << "\033[" << _height+1 << ";0H";
     std::cout.flush();
     dirty_x0 = _width / 2;
@@ -103,13 +401,69 @@ char Renderer::intensity2char(float intensity) {
     return '@';
 }
 
+uint32_t Renderer::color2code(const Color& color) const {
+    if (frame_color_mode == ColorMode::Palette256)
+        return color.quantize256();
+    return color.quantize(color_levels);
+}
+
+void Renderer::emit_color(std::ostream& os, uint32_t code) const {
+    if (frame_color_mode == ColorMode::Palette256)
+        os << "\033[38;5;" << code << 'm';
+    else
+        os << "\033[38;2;" << (code >> 16) << ';' << ((code >> 8) & 0xff) << ';' << (code & 0xff) << 'm';
+}
+
+// Reuses the existing storage when it is large enough. Caller-bound buffers are dropped, the dirty
+// rectangle restarts for the new size and the next render() repaints every cell.
 void Renderer::set_size(int width, int height) {
-    delete [] frame_buffer;
-    delete [] depth_buffer;
     _width = width;
     _height = height;
-    frame_buffer = new char[width*height];
-    depth_buffer = new float[width*height];
+    owns_frame = owns_depth = true;
+    Renderer::allocate(depth_format());
+    tile_cleared.assign(tile_count(), 0);
+    frame_color_mode = ColorMode::None;
+    color_buffer = nullptr;
+    dirty_x0 = width / 2;
+    dirty_y0 = height / 2;
+    dirty_x1 = -width / 2;
+    dirty_y1 = -height / 2;
+    repaint = true;
+}
+
+bool Renderer::bind(char* frame, int frame_stride, float* depth, int depth_stride) {
+    if ((frame && frame_stride < _width) || (depth && depth_stride < _width))
+        return false;
+    owns_frame = !frame;
+    owns_depth = !depth;
+    frame_buffer = frame;
+    _frame_stride = frame_stride;
+    depth_buffer = depth;
+    depth16_buffer = nullptr;
+    _depth_stride = depth_stride;
+    Renderer::allocate(DepthFormat::Float32);
+    tile_cleared.assign(tile_count(), 0);
+    return true;
+}
+
+bool Renderer::bind(char* frame, int frame_stride, uint16_t* depth, int depth_stride) {
+    if ((frame && frame_stride < _width) || (depth && depth_stride < _width))
+        return false;
+    owns_frame = !frame;
+    owns_depth = !depth;
+    frame_buffer = frame;
+    _frame_stride = frame_stride;
+    depth_buffer = nullptr;
+    depth16_buffer = depth;
+    _depth_stride = depth_stride;
+    Renderer::allocate(DepthFormat::Unorm16);
+    tile_cleared.assign(tile_count(), 0);
+    return true;
+}
+
+// Wipes the tiles nothing was drawn to, after which the frame and depth buffers hold the whole frame
+void Renderer::flush() const {
+    Renderer::resolve(0, 0, _width, _height);
 }
 
 float Renderer::width() const {
@@ -120,6 +474,54 @@ float Renderer::height() const {
     return _height;
 }
 
+int Renderer::frame_stride() const {
+    return _frame_stride;
+}
+
+int Renderer::depth_stride() const {
+    return _depth_stride;
+}
+
+// True when every cell under the screen-space rectangle already holds something nearer than z
+bool Renderer::occluded(float x0f, float y0f, float x1f, float y1f, float z) const {
+    int x0 = MAX(-_width/2, std::floor(x0f * _width - 0.5f));
+    int y0 = MAX(-_height/2, std::floor(y0f * _height - 0.5f));
+    int x1 = MIN(_width/2, std::ceil(x1f * _width - 0.5f) + 1);
+    int y1 = MIN(_height/2, std::ceil(y1f * _height - 0.5f) + 1);
+    if (x0 >= x1 || y0 >= y1)
+        return true;
+    Renderer::resolve(x0 + _width/2, y0 + _height/2, x1 + _width/2, y1 + _height/2);
+    uint16_t q = depth16_buffer ? Renderer::encode_depth(z) : 0;
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            int pos = x+_width/2 + (y+_height/2) * _depth_stride;
+            if (depth16_buffer ? depth16_buffer[pos] < q : depth_buffer[pos] < z)
+                return false;
+        }
+    }
+    return true;
+}
+
+const char* Renderer::frame() const {
+    Renderer::resolve(0, 0, _width, _height);
+    return frame_buffer;
+}
+
+const float* Renderer::depth() const {
+    Renderer::resolve(0, 0, _width, _height);
+    return depth_buffer;
+}
+
+const uint16_t* Renderer::depth16() const {
+    Renderer::resolve(0, 0, _width, _height);
+    return depth16_buffer;
+}
+
 #undef MAX
 #undef MIN
-#undef ABS
\ No newline at end of file
+#undef ABS
+#undef SETUP_GRAIN
+#undef SETUP_BATCH
+#undef TILE_WIDTH
+#undef TILE_HEIGHT
+#undef CACHE_LINE
\ No newline at end of file
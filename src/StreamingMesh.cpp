@@ -0,0 +1,461 @@
+#include "StreamingMesh.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAX(x,y) ((x)>(y)?(x):(y))
+#define MIN(x,y) ((x)<(y)?(x):(y))
+#define FLOATS_PER_TRIANGLE 9
+#define READ_BLOCK 4096
+
+typedef std::array<float, FLOATS_PER_TRIANGLE> PackedTriangle;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t chunk_count;
+    uint8_t color[4];
+    uint64_t table_offset;
+};
+
+struct FileChunk {
+    float min[3], max[3];
+    uint64_t offset;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+static const char file_magic[4] = { 'A', '3', 'D', 'S' };
+static const uint32_t file_version = 1;
+
+static AABB empty_bounds() {
+    float inf = std::numeric_limits<float>::infinity();
+    return AABB{ Vector4(inf, inf, inf, 1), Vector4(-inf, -inf, -inf, 1) };
+}
+
+static void grow(AABB& box, const float* vertex) {
+    for (int c = 0; c < 3; c++) {
+        box.min[c] = MIN(box.min[c], vertex[c]);
+        box.max[c] = MAX(box.max[c], vertex[c]);
+    }
+}
+
+static float centroid(const PackedTriangle& tri, int axis) {
+    return (tri[axis] + tri[3 + axis] + tri[6 + axis]) / 3;
+}
+
+StreamingMeshBuilder::StreamingMeshBuilder(const std::string& scratch_path) :
+    scratch_path(scratch_path), count(0), bounds(empty_bounds()) {
+    scratch = fopen(scratch_path.c_str(), "w+b");
+}
+
+StreamingMeshBuilder::~StreamingMeshBuilder() {
+    if (scratch) {
+        fclose(scratch);
+        remove(scratch_path.c_str());
+    }
+}
+
+void StreamingMeshBuilder::add(const Triangle& tri) {
+    PackedTriangle packed;
+    for (int v = 0; v < 3; v++) {
+        for (int c = 0; c < 3; c++)
+            packed[v * 3 + c] = tri[v][c];
+        grow(bounds, &packed[v * 3]);
+    }
+    if (scratch && fwrite(packed.data(), sizeof(PackedTriangle), 1, scratch) == 1)
+        count++;
+}
+
+void StreamingMeshBuilder::add(const Object& obj) {
+    for (const Triangle& tri : obj.triangles())
+        add(tri);
+}
+
+void StreamingMeshBuilder::set_color(const Color& color) {
+    _color = color;
+}
+
+// Writes the triangles as chunks of at most chunk_triangles, sorted along their longest axis so each
+// chunk covers a compact region
+static bool write_chunks(FILE* out, std::vector<PackedTriangle>& tris, int chunk_triangles, uint64_t& offset, std::vector<FileChunk>& table) {
+    if ((int)tris.size() > chunk_triangles) {
+        AABB box = empty_bounds();
+        for (const PackedTriangle& tri : tris)
+            for (int v = 0; v < 3; v++)
+                grow(box, &tri[v * 3]);
+        int axis = 0;
+        for (int c = 1; c < 3; c++)
+            if (box.max[c] - box.min[c] > box.max[axis] - box.min[axis])
+                axis = c;
+        std::sort(tris.begin(), tris.end(), [axis](const PackedTriangle& a, const PackedTriangle& b) {
+            return centroid(a, axis) < centroid(b, axis);
+        });
+    }
+    for (size_t begin = 0; begin < tris.size(); begin += chunk_triangles) {
+        size_t n = MIN((size_t)chunk_triangles, tris.size() - begin);
+        AABB box = empty_bounds();
+        for (size_t i = begin; i < begin + n; i++)
+            for (int v = 0; v < 3; v++)
+                grow(box, &tris[i][v * 3]);
+        FileChunk chunk = { { box.min[0], box.min[1], box.min[2] }, { box.max[0], box.max[1], box.max[2] }, offset, (uint32_t)n, 0 };
+        table.push_back(chunk);
+        if (fwrite(&tris[begin], sizeof(PackedTriangle), n, out) != n)
+            return false;
+        offset += n * sizeof(PackedTriangle);
+    }
+    return true;
+}
+
+// Triangles are bucketed by centroid into a uniform grid sized for about chunk_triangles per cell.
+// One counting pass over the scratch file sizes the cells, and one scatter pass copies every triangle
+// into its cell's contiguous range of a spill file through small per-cell buffers. The read block and
+// the per-cell buffers share memory_budget between them. Each cell is then read back in slices of at
+// most memory_budget bytes, so a crowded cell takes several passes instead of being held whole.
+bool StreamingMeshBuilder::finish(const std::string& path, int chunk_triangles, size_t memory_budget) {
+    if (!scratch || fflush(scratch))
+        return false;
+    chunk_triangles = MAX(1, chunk_triangles);
+    size_t budget_triangles = MAX((size_t)2, memory_budget / sizeof(PackedTriangle));
+    size_t block_triangles = MIN((size_t)READ_BLOCK, budget_triangles / 2);
+
+    int grid = MAX(1, (int)std::ceil(std::cbrt(std::ceil(count / (double)chunk_triangles))));
+    int cells = grid * grid * grid;
+    float extent[3];
+    for (int c = 0; c < 3; c++)
+        extent[c] = MAX(1e-20f, bounds.max[c] - bounds.min[c]);
+    auto cell_of = [&](const PackedTriangle& tri) {
+        int idx = 0;
+        for (int c = 2; c >= 0; c--) {
+            int i = (centroid(tri, c) - bounds.min[c]) / extent[c] * grid;
+            idx = idx * grid + MAX(0, MIN(grid - 1, i));
+        }
+        return idx;
+    };
+    auto scan = [&](const std::function<void(const PackedTriangle&)>& visit) {
+        std::vector<PackedTriangle> block(block_triangles);
+        rewind(scratch);
+        size_t n;
+        while ((n = fread(block.data(), sizeof(PackedTriangle), block.size(), scratch)) > 0)
+            for (size_t i = 0; i < n; i++)
+                visit(block[i]);
+    };
+
+    std::vector<uint64_t> cell_start(cells + 1, 0);
+    scan([&](const PackedTriangle& tri) { cell_start[cell_of(tri) + 1]++; });
+    for (int c = 0; c < cells; c++)
+        cell_start[c + 1] += cell_start[c];
+
+    std::string spill_path = scratch_path + ".cells";
+    FILE* spill = fopen(spill_path.c_str(), "w+b");
+    if (!spill)
+        return false;
+    bool ok = true;
+    {
+        size_t per_cell = MAX((size_t)1, (budget_triangles - block_triangles) / cells);
+        std::vector<std::vector<PackedTriangle>> pending(cells);
+        std::vector<uint64_t> written(cell_start.begin(), cell_start.end() - 1);
+        auto spill_cell = [&](int cell) {
+            std::vector<PackedTriangle>& tris = pending[cell];
+            ok = ok && !fseek(spill, written[cell] * sizeof(PackedTriangle), SEEK_SET)
+                && fwrite(tris.data(), sizeof(PackedTriangle), tris.size(), spill) == tris.size();
+            written[cell] += tris.size();
+            tris.clear();
+        };
+        scan([&](const PackedTriangle& tri) {
+            int cell = cell_of(tri);
+            // Reserved once and kept through clear(), so a buffer never grows past per_cell
+            if (pending[cell].capacity() < per_cell)
+                pending[cell].reserve(per_cell);
+            pending[cell].push_back(tri);
+            if (pending[cell].size() >= per_cell)
+                spill_cell(cell);
+        });
+        for (int c = 0; c < cells; c++)
+            if (!pending[c].empty())
+                spill_cell(c);
+    }
+
+    FILE* out = ok ? fopen(path.c_str(), "wb") : nullptr;
+    if (!out) {
+        fclose(spill);
+        remove(spill_path.c_str());
+        return false;
+    }
+    FileHeader header;
+    memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version = file_version;
+    header.color[0] = _color.r;
+    header.color[1] = _color.g;
+    header.color[2] = _color.b;
+    header.color[3] = 0;
+    ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    uint64_t offset = sizeof(header);
+    std::vector<FileChunk> table;
+
+    std::vector<PackedTriangle> tris;
+    tris.reserve(MIN((uint64_t)budget_triangles, count));
+    for (int c = 0; ok && c < cells; c++) {
+        for (uint64_t begin = cell_start[c]; ok && begin < cell_start[c + 1]; begin += budget_triangles) {
+            size_t n = MIN((uint64_t)budget_triangles, cell_start[c + 1] - begin);
+            tris.resize(n);
+            ok = !fseek(spill, begin * sizeof(PackedTriangle), SEEK_SET)
+                && fread(tris.data(), sizeof(PackedTriangle), n, spill) == n
+                && write_chunks(out, tris, chunk_triangles, offset, table);
+        }
+    }
+    fclose(spill);
+    remove(spill_path.c_str());
+
+    header.chunk_count = table.size();
+    header.table_offset = offset;
+    ok = ok && fwrite(table.data(), sizeof(FileChunk), table.size(), out) == table.size();
+    ok = ok && !fseek(out, 0, SEEK_SET) && fwrite(&header, sizeof(header), 1, out) == 1;
+    return !fclose(out) && ok;
+}
+
+StreamingMesh::StreamingMesh(const std::string& path, size_t budget_bytes) :
+    budget(budget_bytes), used(0), frame(0), has_last(false), stopping(false) {
+    fd = open(path.c_str(), O_RDONLY);
+    FileHeader header;
+    struct stat info;
+    // Sizes come from the file itself, so they are checked against its length before anything is allocated
+    if (fd >= 0 && !fstat(fd, &info) && pread(fd, &header, sizeof(header), 0) == sizeof(header)
+        && !memcmp(header.magic, file_magic, sizeof(file_magic)) && header.version == file_version
+        && header.table_offset >= sizeof(header) && header.table_offset <= (uint64_t)info.st_size
+        && (uint64_t)info.st_size - header.table_offset == (uint64_t)header.chunk_count * sizeof(FileChunk)) {
+        std::vector<FileChunk> table(header.chunk_count);
+        size_t table_bytes = table.size() * sizeof(FileChunk);
+        bool valid = pread(fd, table.data(), table_bytes, header.table_offset) == (ssize_t)table_bytes;
+        for (const FileChunk& entry : table)
+            valid = valid && entry.offset >= sizeof(header) && entry.offset <= header.table_offset
+                && entry.count <= (header.table_offset - entry.offset) / sizeof(PackedTriangle);
+        if (valid) {
+            _color = Color(header.color[0], header.color[1], header.color[2]);
+            for (const FileChunk& entry : table) {
+                AABB box = { Vector4(entry.min[0], entry.min[1], entry.min[2], 1), Vector4(entry.max[0], entry.max[1], entry.max[2], 1) };
+                chunks.push_back(Chunk{ box, entry.offset, entry.count });
+            }
+        }
+    }
+    if (chunks.empty() && fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    resident.resize(chunks.size(), Resident{ nullptr, lru.end(), 0, false });
+    prefetcher = std::thread(&StreamingMesh::prefetch_loop, this);
+}
+
+StreamingMesh::~StreamingMesh() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    prefetcher.join();
+    if (fd >= 0)
+        close(fd);
+}
+
+bool StreamingMesh::is_open() const {
+    return fd >= 0;
+}
+
+size_t StreamingMesh::chunk_count() const {
+    return chunks.size();
+}
+
+size_t StreamingMesh::resident_bytes() {
+    std::lock_guard<std::mutex> guard(lock);
+    return used;
+}
+
+// Resident footprint: the triangles plus the normals Object caches for them
+size_t StreamingMesh::chunk_bytes(const Chunk& chunk) {
+    return chunk.count * (sizeof(Triangle) + sizeof(Vector4));
+}
+
+// Screen rectangle and nearest depth of a chunk's bounds, or false if it is outside the view.
+// Boxes reaching across the w = 0 plane cannot be projected and are always kept.
+bool StreamingMesh::project(const Chunk& chunk, const Matrix4& mvp, Visible& out) const {
+    float inf = std::numeric_limits<float>::infinity();
+    out.x0 = out.y0 = inf;
+    out.x1 = out.y1 = out.z = -inf;
+    int positive = 0;
+    for (int i = 0; i < 8; i++) {
+        Vector4 corner(
+            (i & 1 ? chunk.bounds.max : chunk.bounds.min)[0],
+            (i & 2 ? chunk.bounds.max : chunk.bounds.min)[1],
+            (i & 4 ? chunk.bounds.max : chunk.bounds.min)[2],
+            1
+        );
+        Vector4 clip = mvp * corner;
+        positive += clip[3] > 0;
+        if (std::fabs(clip[3]) < 1e-6f)
+            positive = -8;
+        Vector4 ndc = clip / clip[3];
+        out.x0 = MIN(out.x0, ndc[0]);
+        out.y0 = MIN(out.y0, ndc[1]);
+        out.x1 = MAX(out.x1, ndc[0]);
+        out.y1 = MAX(out.y1, ndc[1]);
+        out.z = MAX(out.z, ndc[2]);
+    }
+    if (positive != 0 && positive != 8) {
+        out.x0 = out.y0 = -0.5f;
+        out.x1 = out.y1 = 0.5f;
+        out.z = inf;
+        return true;
+    }
+    return out.x1 >= -0.5f && out.x0 <= 0.5f && out.y1 >= -0.5f && out.y0 <= 0.5f;
+}
+
+std::shared_ptr<const Object> StreamingMesh::read_chunk(int idx) const {
+    const Chunk& chunk = chunks[idx];
+    std::vector<PackedTriangle> packed(chunk.count);
+    size_t bytes = chunk.count * sizeof(PackedTriangle);
+    if (pread(fd, packed.data(), bytes, chunk.offset) != (ssize_t)bytes)
+        return nullptr;
+    std::vector<Triangle> mesh;
+    mesh.reserve(chunk.count);
+    for (const PackedTriangle& p : packed)
+        mesh.push_back(Triangle(Vector4(p[0], p[1], p[2], 1), Vector4(p[3], p[4], p[5], 1), Vector4(p[6], p[7], p[8], 1)));
+    return std::make_shared<const Object>(std::move(mesh), _color);
+}
+
+// Evicts least recently used chunks until `bytes` more fit in the budget. Called with the lock held. With keep_current,
+// chunks stamped with the current frame are left alone and the call gives up instead.
+bool StreamingMesh::make_room(size_t bytes, bool keep_current) {
+    while (used + bytes > budget && !lru.empty()) {
+        int victim = lru.back();
+        if (keep_current && resident[victim].frame == frame)
+            return false;
+        lru.pop_back();
+        resident[victim].obj.reset();
+        resident[victim].lru = lru.end();
+        used -= chunk_bytes(chunks[victim]);
+    }
+    return used + bytes <= budget;
+}
+
+std::shared_ptr<const Object> StreamingMesh::acquire(int idx) {
+    std::unique_lock<std::mutex> guard(lock);
+    Resident& r = resident[idx];
+    while (r.loading)
+        loaded.wait(guard);
+    if (r.obj) {
+        lru.splice(lru.begin(), lru, r.lru);
+        r.frame = frame;
+        return r.obj;
+    }
+
+    size_t bytes = chunk_bytes(chunks[idx]);
+    bool cache = make_room(bytes, false);
+    if (cache)
+        used += bytes;
+    r.loading = true;
+    guard.unlock();
+    std::shared_ptr<const Object> obj = read_chunk(idx);
+    guard.lock();
+    r.loading = false;
+    if (cache && obj) {
+        r.obj = obj;
+        r.frame = frame;
+        lru.push_front(idx);
+        r.lru = lru.begin();
+    }
+    else if (cache)
+        used -= bytes;
+    loaded.notify_all();
+    return obj;
+}
+
+void StreamingMesh::prefetch_loop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this] { return stopping || !prefetch_queue.empty(); });
+        if (stopping)
+            return;
+        int idx = prefetch_queue.front();
+        prefetch_queue.pop_front();
+        Resident& r = resident[idx];
+        size_t bytes = chunk_bytes(chunks[idx]);
+        if (r.obj || r.loading || !make_room(bytes, true))
+            continue;
+
+        used += bytes;
+        r.loading = true;
+        guard.unlock();
+        std::shared_ptr<const Object> obj = read_chunk(idx);
+        guard.lock();
+        r.loading = false;
+        if (obj) {
+            r.obj = obj;
+            r.frame = frame;
+            lru.push_front(idx);
+            r.lru = lru.begin();
+        }
+        else
+            used -= bytes;
+        loaded.notify_all();
+    }
+}
+
+// Draws visible chunks nearest first so that later ones can be rejected against the depth buffer.
+// Chunks needed now, and those visible from the pose extrapolated from the last two frames, are
+// queued for the prefetcher so loading overlaps with drawing.
+void StreamingMesh::draw(Renderer& renderer, const Matrix4& P, const Matrix4& M, float intensity) {
+    Matrix4 mvp = P * M;
+    Matrix4 predicted = has_last ? mvp + (mvp - last_mvp) : mvp;
+    last_mvp = mvp;
+    has_last = true;
+
+    std::vector<Visible> visible;
+    std::vector<int> upcoming;
+    Visible v;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (project(chunks[i], mvp, v)) {
+            v.chunk = i;
+            visible.push_back(v);
+        }
+        else if (project(chunks[i], predicted, v))
+            upcoming.push_back(i);
+    }
+    std::sort(visible.begin(), visible.end(), [](const Visible& a, const Visible& b) { return a.z > b.z; });
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        frame++;
+        prefetch_queue.clear();
+        for (const Visible& vis : visible) {
+            Resident& r = resident[vis.chunk];
+            if (r.obj) {
+                r.frame = frame;
+                lru.splice(lru.begin(), lru, r.lru);
+            }
+            else if (!r.loading)
+                prefetch_queue.push_back(vis.chunk);
+        }
+        for (int idx : upcoming)
+            if (!resident[idx].obj && !resident[idx].loading)
+                prefetch_queue.push_back(idx);
+    }
+    wake.notify_one();
+
+    for (const Visible& vis : visible) {
+        if (renderer.occluded(vis.x0, vis.y0, vis.x1, vis.y1, vis.z))
+            continue;
+        std::shared_ptr<const Object> obj = acquire(vis.chunk);
+        if (obj)
+            renderer.draw(P, M, *obj, intensity);
+    }
+}
+
+#undef MAX
+#undef MIN
+#undef FLOATS_PER_TRIANGLE
+#undef READ_BLOCK
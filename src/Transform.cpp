@@ -0,0 +1,121 @@
+#include "Transform.hpp"
+#include <algorithm>
+#include <cmath>
+#define PI 3.14159265358979323846
+
+Transform::Transform() :
+    translation{0, 0, 0}, rotation{1, 0, 0, 0}, scale{1, 1, 1}, parent(nullptr),
+    local(Matrix4::Identity), world(Matrix4::Identity), normal(Matrix4::Identity),
+    local_dirty(false), world_dirty(false), normal_dirty(false) {}
+
+Transform::~Transform() {
+    set_parent(nullptr);
+    for (Transform* child : children) {
+        child->parent = nullptr;
+        child->mark_dirty();
+    }
+}
+
+// A dirty node always has dirty descendants, so propagation stops at the first node already marked
+void Transform::mark_dirty() {
+    if (world_dirty)
+        return;
+    world_dirty = normal_dirty = true;
+    for (Transform* child : children)
+        child->mark_dirty();
+}
+
+void Transform::set_parent(Transform* parent) {
+    if (this->parent == parent)
+        return;
+    if (this->parent) {
+        std::vector<Transform*>& siblings = this->parent->children;
+        siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+    }
+    this->parent = parent;
+    if (parent)
+        parent->children.push_back(this);
+    mark_dirty();
+}
+
+void Transform::set_translation(float x, float y, float z) {
+    if (translation[0] == x && translation[1] == y && translation[2] == z)
+        return;
+    translation[0] = x;
+    translation[1] = y;
+    translation[2] = z;
+    local_dirty = true;
+    mark_dirty();
+}
+
+void Transform::set_rotation(float w, float x, float y, float z) {
+    if (rotation[0] == w && rotation[1] == x && rotation[2] == y && rotation[3] == z)
+        return;
+    rotation[0] = w;
+    rotation[1] = x;
+    rotation[2] = y;
+    rotation[3] = z;
+    local_dirty = true;
+    mark_dirty();
+}
+
+// Euler angles in degrees, composed like Matrix4::Rotation(0, x) * Rotation(1, y) * Rotation(2, z)
+void Transform::set_rotation(float x, float y, float z) {
+    float cx = std::cos(x * PI / 360), sx = std::sin(x * PI / 360);
+    float cy = std::cos(y * PI / 360), sy = std::sin(y * PI / 360);
+    float cz = std::cos(z * PI / 360), sz = std::sin(z * PI / 360);
+    set_rotation(
+        cx*cy*cz - sx*sy*sz,
+        sx*cy*cz + cx*sy*sz,
+        cx*sy*cz - sx*cy*sz,
+        cx*cy*sz + sx*sy*cz
+    );
+}
+
+void Transform::set_scale(float x, float y, float z) {
+    if (scale[0] == x && scale[1] == y && scale[2] == z)
+        return;
+    scale[0] = x;
+    scale[1] = y;
+    scale[2] = z;
+    local_dirty = true;
+    mark_dirty();
+}
+
+// T * R * S written out directly instead of multiplying three matrices
+const Matrix4& Transform::local_matrix() const {
+    if (!local_dirty)
+        return local;
+    float w = rotation[0], x = rotation[1], y = rotation[2], z = rotation[3];
+    float n = w*w + x*x + y*y + z*z;
+    float s = n > 0 ? 2 / n : 0;
+    float xx = x*x*s, yy = y*y*s, zz = z*z*s;
+    float xy = x*y*s, xz = x*z*s, yz = y*z*s;
+    float wx = w*x*s, wy = w*y*s, wz = w*z*s;
+    local = Matrix4(
+        (1 - yy - zz) * scale[0],   (xy - wz) * scale[1],       (xz + wy) * scale[2],       translation[0],
+        (xy + wz) * scale[0],       (1 - xx - zz) * scale[1],   (yz - wx) * scale[2],       translation[1],
+        (xz - wy) * scale[0],       (yz + wx) * scale[1],       (1 - xx - yy) * scale[2],   translation[2],
+        0.f,                        0.f,                        0.f,                        1.f
+    );
+    local_dirty = false;
+    return local;
+}
+
+const Matrix4& Transform::world_matrix() const {
+    if (!world_dirty)
+        return world;
+    world = parent ? parent->world_matrix() * local_matrix() : local_matrix();
+    world_dirty = false;
+    return world;
+}
+
+const Matrix4& Transform::normal_matrix() const {
+    if (!normal_dirty)
+        return normal;
+    normal = world_matrix().normal_matrix();
+    normal_dirty = false;
+    return normal;
+}
+
+#undef PI
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define MAX(x,y) ((x)>(y)?(x):(y))
 #define MIN(x,y) ((x)<(y)?(x):(y))
 
+Triangle::Triangle() {}
+
 Triangle::Triangle(const Vector4 vert0, const Vector4 vert1, const Vector4 vert2) {
     this->vertex[0] = vert0;
     this->vertex[1] = vert1;
@@ -41,6 +43,10 @@ float sign(float x0, float y0, float x1, float y1, float x2, float y2) {
 }
 
 bool Triangle::contains(float x, float y, float& z) const {
+    return this->contains(x, y, this->normal(), z);
+}
+
+bool Triangle::contains(float x, float y, const Vector4& normal, float& z) const {
     float d0 = sign(x, y, this->vertex[0][0], this->vertex[0][1], this->vertex[1][0], this->vertex[1][1]);
     float d1 = sign(x, y, this->vertex[1][0], this->vertex[1][1], this->vertex[2][0], this->vertex[2][1]);
     float d2 = sign(x, y, this->vertex[2][0], this->vertex[2][1], this->vertex[0][0], this->vertex[0][1]);
@@ -50,10 +56,8 @@ bool Triangle::contains(float x, float y, float& z) const {
 
     bool inside = !(has_neg && has_pos);
 
-    if (inside) {
-        Vector4 normal = this->normal();
+    if (inside)
         z = (normal.dot(this->vertex[0]) - normal[0]*x - normal[1]*y) / normal[2];
-    }
 
     return inside;
 }
@@ -0,0 +1,171 @@
+#include "ascii3d.h"
+#include "Renderer.hpp"
+#include "JobSystem.hpp"
+#include <new>
+
+// Exceptions must not cross into C callers, so allocation failures turn into error codes here
+struct a3d_renderer {
+    Renderer renderer;
+
+    a3d_renderer(int width, int height, float zfar, float znear) :
+        renderer(width, height, zfar, znear) {}
+};
+
+struct a3d_mesh {
+    Object obj;
+};
+
+static Matrix4 to_matrix(const float* m) {
+    return m ? Matrix4(m) : Matrix4::Identity;
+}
+
+// Builds the lazily cached per-triangle data up front, so drawing a mesh never writes to it
+static a3d_mesh* warmed(a3d_mesh* mesh) {
+    mesh->obj.normals();
+    return mesh;
+}
+
+int a3d_api_version(void) {
+    return A3D_API_VERSION;
+}
+
+int a3d_set_worker_threads(int count) {
+    if (count < 0)
+        return A3D_EINVAL;
+    return JobSystem::set_global_workers(count) ? A3D_OK : A3D_EBUSY;
+}
+
+a3d_renderer* a3d_renderer_create(int width, int height, float zfar, float znear) {
+    if (width <= 0 || height <= 0 || !(zfar > znear) || !(znear > 0))
+        return nullptr;
+    try {
+        return new a3d_renderer(width, height, zfar, znear);
+    }
+    catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void a3d_renderer_destroy(a3d_renderer* renderer) {
+    delete renderer;
+}
+
+int a3d_renderer_bind(a3d_renderer* renderer, char* frame, int frame_stride, void* depth, int depth_stride, int depth_format) {
+    if (!renderer || (depth_format != A3D_DEPTH_FLOAT32 && depth_format != A3D_DEPTH_UNORM16))
+        return A3D_EINVAL;
+    try {
+        bool ok = depth_format == A3D_DEPTH_FLOAT32
+            ? renderer->renderer.bind(frame, frame_stride, (float*)depth, depth_stride)
+            : renderer->renderer.bind(frame, frame_stride, (uint16_t*)depth, depth_stride);
+        return ok ? A3D_OK : A3D_EINVAL;
+    }
+    catch (const std::bad_alloc&) {
+        return A3D_ENOMEM;
+    }
+}
+
+int a3d_renderer_set_size(a3d_renderer* renderer, int width, int height) {
+    if (!renderer || width <= 0 || height <= 0)
+        return A3D_EINVAL;
+    try {
+        renderer->renderer.set_size(width, height);
+        return A3D_OK;
+    }
+    catch (const std::bad_alloc&) {
+        return A3D_ENOMEM;
+    }
+}
+
+void a3d_renderer_set_detail_charset(a3d_renderer* renderer, int detail) {
+    if (renderer)
+        renderer->renderer.detail_charset = detail != 0;
+}
+
+void a3d_renderer_clear(a3d_renderer* renderer) {
+    if (renderer)
+        renderer->renderer.clear();
+}
+
+int a3d_renderer_draw(a3d_renderer* renderer, const float projection[16], const float model[16], const a3d_mesh* mesh, float intensity) {
+    if (!renderer || !projection || !mesh)
+        return A3D_EINVAL;
+    try {
+        renderer->renderer.draw(Matrix4(projection), to_matrix(model), mesh->obj, intensity);
+        return A3D_OK;
+    }
+    catch (const std::bad_alloc&) {
+        return A3D_ENOMEM;
+    }
+}
+
+void a3d_renderer_finish(a3d_renderer* renderer) {
+    if (renderer)
+        renderer->renderer.flush();
+}
+
+const char* a3d_renderer_frame(a3d_renderer* renderer, int* stride) {
+    if (!renderer)
+        return nullptr;
+    if (stride)
+        *stride = renderer->renderer.frame_stride();
+    return renderer->renderer.frame();
+}
+
+a3d_mesh* a3d_mesh_create(const float* vertices, int triangle_count) {
+    if (!vertices || triangle_count < 0)
+        return nullptr;
+    try {
+        std::vector<Triangle> mesh;
+        mesh.reserve(triangle_count);
+        for (int i = 0; i < triangle_count; i++) {
+            const float* v = vertices + 9 * (size_t)i;
+            mesh.push_back(Triangle(Vector4(v[0], v[1], v[2], 1), Vector4(v[3], v[4], v[5], 1), Vector4(v[6], v[7], v[8], 1)));
+        }
+        return warmed(new a3d_mesh{Object(std::move(mesh))});
+    }
+    catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+a3d_mesh* a3d_mesh_create_indexed(const float* positions, int vertex_count, const uint32_t* indices, int triangle_count) {
+    if (!positions || !indices || vertex_count < 0 || triangle_count < 0)
+        return nullptr;
+    // Offsets are computed in size_t, counts near INT_MAX would overflow int arithmetic
+    for (size_t i = 0; i < 3 * (size_t)triangle_count; i++)
+        if (indices[i] >= (uint32_t)vertex_count)
+            return nullptr;
+    try {
+        std::vector<Triangle> mesh;
+        mesh.reserve(triangle_count);
+        for (int i = 0; i < triangle_count; i++) {
+            Vector4 vert[3];
+            for (int k = 0; k < 3; k++) {
+                const float* p = positions + 3 * (size_t)indices[3 * (size_t)i + k];
+                vert[k] = Vector4(p[0], p[1], p[2], 1);
+            }
+            mesh.push_back(Triangle(vert[0], vert[1], vert[2]));
+        }
+        return warmed(new a3d_mesh{Object(std::move(mesh))});
+    }
+    catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void a3d_mesh_set_color(a3d_mesh* mesh, uint8_t r, uint8_t g, uint8_t b) {
+    if (mesh)
+        mesh->obj.set_color(Color(r, g, b));
+}
+
+void a3d_mesh_destroy(a3d_mesh* mesh) {
+    delete mesh;
+}
+
+void a3d_perspective(float out[16], float aspect, float fov, float zfar, float znear) {
+    // Must be const: the non-const operator[] of Matrix4 indexes column-major
+    const Matrix4 P = Matrix4::Perspective(aspect, fov, zfar, znear);
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            out[c + r * 4] = P[std::pair<int, int>(r, c)];
+}
\ No newline at end of file
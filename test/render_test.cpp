@@ -0,0 +1,479 @@
+#include "Renderer.hpp"
+#include "StreamingMesh.hpp"
+#include "ascii3d.h"
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#define GOLDEN_DIR "test/golden"
+#define BASELINE_FILE "test/baseline.txt"
+#define DEPTH_TOLERANCE 5e-5
+#define TIMING_RUNS 15
+#define MAX_REPORTED_ROWS 8
+#define VARIANT_MAX_DIFF 0.02
+#define BIND_PADDING 5
+#define STREAM_FILE "test/stream.tmp"
+#define STREAM_GRID 64
+#define STREAM_CHUNK 256
+#define STREAM_BUILD_BUDGET (64 << 10)
+#define STREAM_BUILD_SLACK (16 << 10)
+
+// Every allocation records its size in front of the block, so a check can read the peak heap use of a call
+static std::atomic<size_t> heap_live(0), heap_peak(0);
+
+void* operator new(size_t size) {
+    size_t* block = (size_t*)malloc(size + 16);
+    if (!block)
+        throw std::bad_alloc();
+    *block = size;
+    size_t live = heap_live += size, peak = heap_peak;
+    while (live > peak && !heap_peak.compare_exchange_weak(peak, live));
+    return (char*)block + 16;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr)
+        return;
+    size_t* block = (size_t*)((char*)ptr - 16);
+    heap_live -= *block;
+    free(block);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+struct Scene {
+    std::string name;
+    Object mesh;
+};
+
+struct Resolution {
+    int width, height;
+};
+
+static std::vector<Scene> scenes() {
+    std::vector<Scene> ret;
+    ret.push_back({"triangle", TriangularMesh(Vector4(-1, -1, 0, 1), Vector4(1, -1, 0, 1), Vector4(0, std::sqrt(3)-1, 0, 1))});
+    ret.push_back({"rectangle", RectangularMesh(Vector4(-1, -1, 0, 1), Vector4(-1, 1, 0, 1), Vector4(1, 1, 0, 1), Vector4(1, -1, 0, 1))});
+    ret.push_back({"tetrahedron", Matrix4::Scale(0.5, 0.5, 0.5) * TetrahedronMesh()});
+    ret.push_back({"cube", Matrix4::Scale(2, 2, 2) * CubeMesh()});
+    ret.push_back({"icosahedron", IcosahedronMesh()});
+    ret.push_back({"sphere", SphereMesh(1)});
+    return ret;
+}
+
+static const Resolution resolutions[] = { {24, 12}, {48, 24}, {80, 40} };
+
+// Same pose main.cpp shows after 37 frames
+static Matrix4 model() {
+    float angle = 37;
+    return Matrix4::Translation(0, 1.5*std::cos(0.08*angle), 35) * Matrix4::Rotation(0, 0.2*angle) * Matrix4::Rotation(1, 0.8*angle) * Matrix4::Rotation(2, 1.0*angle) * Matrix4::Scale(4.5, 4.5, 4.5);
+}
+
+static Matrix4 projection(const Resolution& res) {
+    return Matrix4::Perspective((res.width / 2.0) / res.height, 60, 1000, 0.3);
+}
+
+static void render_scene(Renderer& renderer, const Matrix4& P, const Object& mesh) {
+    renderer.clear();
+    renderer.draw(P, model(), mesh, 0.8);
+}
+
+static void render_compact(Renderer& renderer, const Matrix4& P, const CompactObject& mesh) {
+    renderer.clear();
+    renderer.draw(P, model(), mesh, 0.8);
+}
+
+struct Frame {
+    int width, height;
+    std::vector<std::string> rows;
+    std::vector<float> depth;
+};
+
+static Frame capture(const Renderer& renderer, const Resolution& res) {
+    Frame frame { res.width, res.height, {}, {} };
+    for (int y = 0; y < res.height; y++)
+        frame.rows.push_back(std::string(renderer.frame() + y * renderer.frame_stride(), res.width));
+    frame.depth.assign(res.width * res.height, 0);
+    if (renderer.depth())
+        for (int y = 0; y < res.height; y++)
+            std::copy(renderer.depth() + y * renderer.depth_stride(), renderer.depth() + y * renderer.depth_stride() + res.width,
+                      frame.depth.begin() + y * res.width);
+    return frame;
+}
+
+static std::string golden_path(const Scene& scene, const Resolution& res) {
+    return std::string(GOLDEN_DIR) + "/" + scene.name + "_" + std::to_string(res.width) + "x" + std::to_string(res.height) + ".txt";
+}
+
+static bool write_golden(const std::string& path, const Frame& frame) {
+    std::ofstream file(path);
+    if (!file)
+        return false;
+    file << frame.width << ' ' << frame.height << "\nframe\n";
+    for (const std::string& row : frame.rows)
+        file << '|' << row << "|\n";
+    file << "depth\n";
+    char cell[32];
+    for (int y = 0; y < frame.height; y++) {
+        for (int x = 0; x < frame.width; x++) {
+            snprintf(cell, sizeof(cell), "%.6g", frame.depth[x + y * frame.width]);
+            file << (x ? " " : "") << cell;
+        }
+        file << '\n';
+    }
+    return (bool)file;
+}
+
+static bool read_golden(const std::string& path, Frame& frame) {
+    std::ifstream file(path);
+    std::string line;
+    if (!(file >> frame.width >> frame.height) || !(file >> line) || line != "frame")
+        return false;
+    std::getline(file, line);
+    frame.rows.clear();
+    for (int y = 0; y < frame.height; y++) {
+        if (!std::getline(file, line) || line.size() != (size_t)frame.width + 2)
+            return false;
+        frame.rows.push_back(line.substr(1, frame.width));
+    }
+    if (!(file >> line) || line != "depth")
+        return false;
+    frame.depth.resize(frame.width * frame.height);
+    for (float& z : frame.depth)
+        if (!(file >> z))
+            return false;
+    return true;
+}
+
+static bool compare_frames(const Frame& expected, const Frame& actual) {
+    if (expected.width != actual.width || expected.height != actual.height) {
+        std::cout << "    size mismatch: expected " << expected.width << 'x' << expected.height
+                  << ", got " << actual.width << 'x' << actual.height << '\n';
+        return false;
+    }
+
+    int bad_rows = 0, bad_cells = 0;
+    for (int y = 0; y < actual.height; y++) {
+        if (expected.rows[y] == actual.rows[y])
+            continue;
+        std::string marker(actual.width, ' ');
+        for (int x = 0; x < actual.width; x++) {
+            if (expected.rows[y][x] != actual.rows[y][x]) {
+                marker[x] = '^';
+                bad_cells++;
+            }
+        }
+        if (bad_rows++ < MAX_REPORTED_ROWS) {
+            printf("    row %3d expected |%s|\n", y, expected.rows[y].c_str());
+            printf("            actual   |%s|\n", actual.rows[y].c_str());
+            printf("                      %s\n", marker.c_str());
+        }
+    }
+    if (bad_rows)
+        std::cout << "    frame: " << bad_cells << " cells differ in " << bad_rows << " rows\n";
+
+    int bad_depth = 0, worst = -1;
+    float worst_error = 0;
+    for (int i = 0; i < actual.width * actual.height; i++) {
+        float error = std::fabs(expected.depth[i] - actual.depth[i]);
+        if (error > DEPTH_TOLERANCE * std::max(1.f, std::fabs(expected.depth[i]))) {
+            bad_depth++;
+            if (error > worst_error) {
+                worst_error = error;
+                worst = i;
+            }
+        }
+    }
+    if (bad_depth)
+        printf("    depth: %d cells out of tolerance, worst at (%d, %d) expected %.6g got %.6g\n",
+               bad_depth, worst % actual.width, worst / actual.width, expected.depth[worst], actual.depth[worst]);
+
+    return !bad_rows && !bad_depth;
+}
+
+// Lossy variants (quantized meshes, 16-bit depth) may differ from the reference only in a small fraction of the covered cells
+static bool compare_variant(const char* label, const Frame& reference, const Frame& variant, const std::string& note) {
+    int covered = 0, differ = 0;
+    for (int y = 0; y < reference.height; y++) {
+        for (int x = 0; x < reference.width; x++) {
+            covered += reference.rows[y][x] != ' ';
+            differ += reference.rows[y][x] != variant.rows[y][x];
+        }
+    }
+    bool ok = differ <= VARIANT_MAX_DIFF * covered + 1;
+    printf("%s %s: %d of %d cells differ%s\n", ok ? "       " : "[FAIL] ", label, differ, covered, note.c_str());
+    return ok;
+}
+
+static void to_floats(const Matrix4& m, float out[16]) {
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            out[c + r * 4] = m[std::pair<int, int>(r, c)];
+}
+
+// Renders through the C API, projection included, into padded caller-owned rows; the frame must match
+// exactly and the padding stay untouched
+static bool compare_bound(const Frame& reference, const Object& mesh) {
+    int width = reference.width, height = reference.height, stride = width + BIND_PADDING;
+    std::vector<char> frame(stride * height, '?');
+    std::vector<float> depth(stride * height, -1);
+    std::vector<float> vertices;
+    for (const Triangle& tri : mesh.triangles())
+        for (int k = 0; k < 3; k++)
+            for (int i = 0; i < 3; i++)
+                vertices.push_back(tri[k][i]);
+    float projection[16], transform[16];
+    a3d_perspective(projection, (width / 2.0) / height, 60, 1000, 0.3);
+    to_floats(model(), transform);
+
+    a3d_renderer* renderer = a3d_renderer_create(width, height, 1000, 0.3);
+    a3d_mesh* obj = a3d_mesh_create(vertices.data(), mesh.triangles().size());
+    bool ok = renderer && obj && a3d_renderer_bind(renderer, frame.data(), stride, depth.data(), stride, A3D_DEPTH_FLOAT32) == A3D_OK;
+    if (ok) {
+        a3d_renderer_clear(renderer);
+        ok = a3d_renderer_draw(renderer, projection, transform, obj, 0.8) == A3D_OK;
+        a3d_renderer_finish(renderer);
+    }
+    int differ = 0, clobbered = 0;
+    for (int y = 0; ok && y < height; y++) {
+        for (int x = 0; x < width; x++)
+            differ += reference.rows[y][x] != frame[x + y * stride];
+        for (int x = width; x < stride; x++)
+            clobbered += frame[x + y * stride] != '?' || depth[x + y * stride] != -1;
+    }
+    a3d_mesh_destroy(obj);
+    a3d_renderer_destroy(renderer);
+    ok = ok && !differ && !clobbered;
+    printf("%s bound: %d cells differ, %d padding cells written, stride %d\n", ok ? "       " : "[FAIL] ", differ, clobbered, stride);
+    return ok;
+}
+
+// Wavy height field, dense enough to span many chunks
+static Object terrain() {
+    std::vector<Triangle> tris;
+    auto vertex = [](int i, int j) {
+        float x = 2.0 * i / STREAM_GRID - 1, y = 2.0 * j / STREAM_GRID - 1;
+        return Vector4(x, y, 0.1 * std::sin(3 * x) * std::cos(3 * y), 1);
+    };
+    for (int j = 0; j < STREAM_GRID; j++) {
+        for (int i = 0; i < STREAM_GRID; i++) {
+            tris.push_back(Triangle(vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1)));
+            tris.push_back(Triangle(vertex(i, j), vertex(i + 1, j + 1), vertex(i, j + 1)));
+        }
+    }
+    return Object(tris, Color(95, 255, 135));
+}
+
+// Streams a chunk file under a budget of a quarter of the mesh, which forces eviction while drawing,
+// and compares the frame with drawing the mesh directly. Broken files must open as empty.
+static int check_streaming() {
+    int failures = 0;
+    Resolution res = { 80, 40 };
+    Matrix4 P = projection(res);
+    Matrix4 M = Matrix4::Translation(0, 0, 35) * Matrix4::Rotation(0, 0.6) * Matrix4::Scale(12, 12, 12);
+    Object mesh = terrain();
+    size_t budget = mesh.triangles().size() * (sizeof(Triangle) + sizeof(Vector4)) / 4;
+
+    Renderer renderer(res.width, res.height, 1000, 0.3);
+    renderer.clear();
+    renderer.draw(P, M, mesh, 0.8);
+    Frame direct = capture(renderer, res);
+
+    StreamingMeshBuilder builder(STREAM_FILE ".scratch");
+    builder.add(mesh);
+    builder.set_color(mesh.color());
+    // The build budget is far below one grid cell, so cells are written in several slices. Besides
+    // the budget the builder only keeps bookkeeping per cell and per chunk, well within the slack.
+    size_t base = heap_live;
+    heap_peak = base;
+    bool built = builder.finish(STREAM_FILE, STREAM_CHUNK, STREAM_BUILD_BUDGET);
+    size_t build_peak = heap_peak - base;
+    bool bounded = build_peak <= STREAM_BUILD_BUDGET + STREAM_BUILD_SLACK;
+    printf("%s streaming build: %zu bytes peak for a %d byte budget\n", bounded ? "[ OK ]" : "[FAIL]", build_peak, STREAM_BUILD_BUDGET);
+    failures += !bounded;
+    StreamingMesh streamed(STREAM_FILE, budget);
+    bool ok = built && streamed.is_open() && streamed.chunk_count() >= mesh.triangles().size() / STREAM_CHUNK;
+    if (ok) {
+        for (int i = 0; i < 3; i++) {
+            renderer.clear();
+            streamed.draw(renderer, P, M, 0.8);
+            ok = ok && streamed.resident_bytes() <= budget;
+        }
+    }
+    printf("%s streaming: %zu chunks, %zu of %zu bytes resident\n", ok ? "[ OK ]" : "[FAIL]",
+           streamed.chunk_count(), streamed.resident_bytes(), budget);
+    failures += !ok;
+    if (ok && !compare_variant("streamed", direct, capture(renderer, res), ""))
+        failures++;
+
+    std::ifstream in(STREAM_FILE, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string truncated = bytes.substr(0, bytes.size() - 7);
+    std::string bad_magic = bytes;
+    bad_magic[0] = 'X';
+    std::string huge_table = bytes;
+    huge_table[8] = huge_table[9] = huge_table[10] = huge_table[11] = (char)0xff;
+    const std::pair<const char*, std::string*> broken[] = {
+        {"truncated", &truncated}, {"bad magic", &bad_magic}, {"bad chunk count", &huge_table}
+    };
+    for (const auto& b : broken) {
+        std::ofstream(STREAM_FILE, std::ios::binary) << *b.second;
+        StreamingMesh bad(STREAM_FILE, budget);
+        renderer.clear();
+        bad.draw(renderer, P, M, 0.8);
+        bool rejected = !bad.is_open() && !bad.chunk_count();
+        printf("%s streaming %s file rejected\n", rejected ? "[ OK ]" : "[FAIL]", b.first);
+        failures += !rejected;
+    }
+    remove(STREAM_FILE);
+    return failures;
+}
+
+static double time_scene(Renderer& renderer, const Matrix4& P, const Object& mesh) {
+    std::vector<double> samples;
+    for (int i = 0; i < TIMING_RUNS; i++) {
+        auto begin = std::chrono::steady_clock::now();
+        render_scene(renderer, P, mesh);
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+static std::map<std::string, double> read_baseline() {
+    std::map<std::string, double> ret;
+    std::ifstream file(BASELINE_FILE);
+    std::string name;
+    double us;
+    while (file >> name >> us)
+        ret[name] = us;
+    return ret;
+}
+
+static void write_baseline(const std::map<std::string, double>& baseline) {
+    std::ofstream file(BASELINE_FILE);
+    for (const auto& entry : baseline)
+        file << entry.first << ' ' << entry.second << '\n';
+}
+
+int main(int argc, char** argv) {
+    bool update = false;
+    double tolerance = 0.5;
+    if (const char* env = getenv("ASCII3D_PERF_TOLERANCE"))
+        tolerance = atof(env);
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--update"))
+            update = true;
+        else if (!strncmp(argv[i], "--tolerance=", 12))
+            tolerance = atof(argv[i] + 12);
+        else {
+            std::cerr << "usage: " << argv[0] << " [--update] [--tolerance=FRACTION]\n";
+            return 2;
+        }
+    }
+
+    std::map<std::string, double> baseline = read_baseline();
+    std::map<std::string, double> timings;
+    int failures = 0, slow = 0;
+    // Shared by every scene and size, so it keeps shrinking and growing into reused storage
+    Renderer resized(1, 1, 1000, 0.3);
+
+    for (const Scene& scene : scenes()) {
+        for (const Resolution& res : resolutions) {
+            std::string name = scene.name + "_" + std::to_string(res.width) + "x" + std::to_string(res.height);
+            std::string path = golden_path(scene, res);
+            Renderer renderer(res.width, res.height, 1000, 0.3);
+            Matrix4 P = projection(res);
+
+            render_scene(renderer, P, scene.mesh);
+            Frame actual = capture(renderer, res);
+            double us = time_scene(renderer, P, scene.mesh);
+            timings[name] = us;
+
+            if (update) {
+                if (!write_golden(path, actual)) {
+                    std::cout << "[FAIL] " << name << ": cannot write " << path << '\n';
+                    failures++;
+                }
+                else
+                    std::cout << "[UPDATE] " << name << '\n';
+                continue;
+            }
+
+            Frame expected;
+            if (!read_golden(path, expected)) {
+                std::cout << "[FAIL] " << name << ": missing or malformed " << path << '\n';
+                failures++;
+                continue;
+            }
+            bool match = compare_frames(expected, actual);
+
+            std::string perf;
+            auto base = baseline.find(name);
+            if (base != baseline.end()) {
+                char buf[96];
+                snprintf(buf, sizeof(buf), " %.1fus (baseline %.1fus, %+.0f%%)", us, base->second, 100 * (us / base->second - 1));
+                perf = buf;
+                if (us > base->second * (1 + tolerance)) {
+                    perf += " SLOW";
+                    slow++;
+                }
+            }
+            else
+                perf = " " + std::to_string((int)us) + "us (no baseline)";
+
+            std::cout << (match ? "[ OK ] " : "[FAIL] ") << name << perf << '\n';
+            if (!match)
+                failures++;
+
+            CompactObject compact(scene.mesh);
+            render_compact(renderer, P, compact);
+            std::string note = ", " + std::to_string(compact.bytes()) + " bytes vs " + std::to_string(scene.mesh.triangles().size() * (sizeof(Triangle) + sizeof(Vector4)));
+            if (!compare_variant("compact", actual, capture(renderer, res), note))
+                failures++;
+
+            if (!compare_bound(actual, scene.mesh))
+                failures++;
+
+            resized.set_size(res.width, res.height);
+            render_scene(resized, P, scene.mesh);
+            bool same = compare_frames(actual, capture(resized, res));
+            printf("%s resized: %s, stride %d\n", same ? "       " : "[FAIL] ", same ? "identical" : "differs", resized.frame_stride());
+            if (!same)
+                failures++;
+
+            renderer.set_depth_format(DepthFormat::Unorm16);
+            render_scene(renderer, P, scene.mesh);
+            if (!compare_variant("depth16", actual, capture(renderer, res), ""))
+                failures++;
+        }
+    }
+
+    if (!update)
+        failures += check_streaming();
+
+    if (update) {
+        write_baseline(timings);
+        std::cout << "updated goldens in " GOLDEN_DIR " and timings in " BASELINE_FILE "\n";
+        return failures ? 1 : 0;
+    }
+
+    if (slow)
+        std::cout << slow << " scenes slower than baseline by more than " << tolerance * 100 << "%\n";
+    if (failures)
+        std::cout << failures << " scenes differ from golden frames\n";
+    return failures || slow ? 1 : 0;
+}
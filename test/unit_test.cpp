@@ -0,0 +1,478 @@
+#include "Renderer.hpp"
+#include "JobSystem.hpp"
+#include "TripleBuffer.hpp"
+#include "FrameScheduler.hpp"
+#include "Transform.hpp"
+#include "ascii3d.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Unit checks for the pieces render_test cannot see through a rendered frame
+static int failures = 0;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+static void check(bool ok, const char* expr, const char* file, int line) {
+    if (ok)
+        return;
+    failures++;
+    printf("       %s:%d: %s\n", file, line, expr);
+}
+
+static void object_normals_shared() {
+    std::vector<Triangle> tris;
+    for (int i = 0; i < 20000; i++)
+        tris.push_back(Triangle(Vector4(i, 0, 0, 1), Vector4(i, 1, i % 7, 1), Vector4(i + 1, 0, 1, 1)));
+    const Object obj(tris);
+
+    // Every thread races to build the cache; all must see the same fully built normals
+    std::vector<const std::vector<Vector4>*> seen(8, nullptr);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < seen.size(); t++)
+        threads.emplace_back([&, t] { seen[t] = &obj.normals(); });
+    for (std::thread& t : threads)
+        t.join();
+    for (const std::vector<Vector4>* normals : seen)
+        CHECK(normals == seen[0]);
+    CHECK(seen[0]->size() == tris.size());
+    bool equal = true;
+    for (size_t i = 0; i < tris.size(); i++)
+        for (int c = 0; c < 3; c++)
+            equal &= (*seen[0])[i][c] == tris[i].normal()[c];
+    CHECK(equal);
+
+    Object copy(obj);
+    CHECK(copy.normals().size() == tris.size());
+    Object moved = Matrix4::Scale(2, 2, 2) * obj;
+    CHECK(moved.normals().size() == tris.size());
+
+    // Moves hand over the triangle storage and the built cache instead of copying them
+    const Triangle* storage = copy.triangles().data();
+    const Vector4* normals = copy.normals().data();
+    Object taken(std::move(copy));
+    CHECK(taken.triangles().data() == storage && taken.normals().data() == normals);
+    moved = std::move(taken);
+    CHECK(moved.triangles().data() == storage && moved.normals().data() == normals);
+    std::vector<Triangle> source(tris);
+    storage = source.data();
+    Object adopted(std::move(source), Color(1, 2, 3));
+    CHECK(adopted.triangles().data() == storage);
+}
+
+static void c_api_matrices_and_pool() {
+    float out[16];
+    a3d_perspective(out, 1.5, 60, 1000, 0.3);
+    const Matrix4 P = Matrix4::Perspective(1.5, 60, 1000, 0.3);
+    bool row_major = true;
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            row_major &= out[c + r * 4] == P[std::pair<int, int>(r, c)];
+    CHECK(row_major);
+    CHECK(out[14] == -1);
+
+    JobSystem::global();
+    CHECK(a3d_set_worker_threads(2) == A3D_EBUSY);
+    CHECK(a3d_set_worker_threads(-1) == A3D_EINVAL);
+}
+
+// A wall right at the near plane must use the top of the 16-bit range and one at the far plane the bottom
+static uint16_t depth16_at(float distance) {
+    Renderer renderer(8, 4, 1000, 0.3);
+    renderer.set_depth_format(DepthFormat::Unorm16);
+    RectangularMesh wall(Vector4(-1, -1, 0, 1), Vector4(-1, 1, 0, 1), Vector4(1, 1, 0, 1), Vector4(1, -1, 0, 1));
+    renderer.clear();
+    renderer.draw(Matrix4::Perspective(1, 60, 1000, 0.3), Matrix4::Translation(0, 0, distance) * Matrix4::Scale(distance, distance, 1), wall, 0.8);
+    return renderer.depth16()[4 + 2 * renderer.depth_stride()];
+}
+
+static void depth16_code_range() {
+    uint16_t near = depth16_at(0.31), middle = depth16_at(35), far = depth16_at(900);
+    CHECK(near > 60000);
+    CHECK(middle < near && far < middle);
+    CHECK(far > 0 && far < 100);
+}
+
+static void jobs_parallel_for_exactly_once() {
+    for (int workers : {0, 3}) {
+        JobSystem jobs(workers);
+        for (int grain : {1, 7, 1000, 5000}) {
+            std::vector<std::atomic<int>> hits(4000);
+            jobs.parallel_for(0, hits.size(), grain, [&](int begin, int end) {
+                for (int i = begin; i < end; i++)
+                    hits[i]++;
+            });
+            CHECK(std::all_of(hits.begin(), hits.end(), [](const std::atomic<int>& h) { return h == 1; }));
+        }
+        bool ran = false;
+        jobs.parallel_for(5, 5, 1, [&](int, int) { ran = true; });
+        CHECK(!ran);
+    }
+}
+
+// One worker spawns slow tasks onto its own queue; the idle workers have to steal them
+static void jobs_steal_imbalanced() {
+    JobSystem jobs(3);
+    std::mutex lock;
+    std::set<std::thread::id> runners;
+    std::atomic<int> outer(0), done(0);
+    jobs.submit([&] {
+        std::atomic<int> inner(0);
+        for (int i = 0; i < 32; i++) {
+            jobs.submit([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                std::lock_guard<std::mutex> guard(lock);
+                runners.insert(std::this_thread::get_id());
+                done++;
+            }, inner);
+        }
+        jobs.wait(inner);
+    }, outer);
+    // Poll without helping, so only workers run the tasks
+    while (outer.load() > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(done == 32);
+    CHECK(runners.size() >= 2);
+    CHECK(!runners.count(std::this_thread::get_id()));
+}
+
+static void jobs_wait_outside_workers() {
+    JobSystem inline_jobs(0);
+    std::atomic<int> pending(0), count(0);
+    for (int i = 0; i < 10; i++)
+        inline_jobs.submit([&] { count++; }, pending);
+    inline_jobs.wait(pending);
+    CHECK(count == 10 && pending == 0);
+
+    JobSystem jobs(2);
+    std::vector<std::thread> callers;
+    std::atomic<int> total(0);
+    for (int t = 0; t < 3; t++) {
+        callers.emplace_back([&] {
+            std::atomic<int> mine(0);
+            for (int i = 0; i < 100; i++)
+                jobs.submit([&] { total++; }, mine);
+            jobs.wait(mine);
+            CHECK(mine == 0);
+        });
+    }
+    for (std::thread& t : callers)
+        t.join();
+    CHECK(total == 300);
+}
+
+static void task_graph_order() {
+    JobSystem jobs(3);
+    for (int run = 0; run < 50; run++) {
+        std::atomic<int> clock(0);
+        int at[4] = {-1, -1, -1, -1};
+        TaskGraph graph;
+        int a = graph.add([&] { at[0] = clock++; });
+        int b = graph.add([&] { at[1] = clock++; });
+        int c = graph.add([&] { at[2] = clock++; });
+        int d = graph.add([&] { at[3] = clock++; });
+        graph.precede(a, b);
+        graph.precede(a, c);
+        graph.precede(b, d);
+        graph.precede(c, d);
+        graph.run(jobs);
+        CHECK(at[0] == 0 && at[3] == 3);
+        CHECK(at[1] > at[0] && at[2] > at[0] && at[3] > at[1] && at[3] > at[2]);
+    }
+
+    TaskGraph chain;
+    std::vector<int> order;
+    for (int i = 0; i < 100; i++) {
+        chain.add([&, i] { order.push_back(i); });
+        if (i)
+            chain.precede(i - 1, i);
+    }
+    chain.run(jobs);
+    bool sorted = order.size() == 100;
+    for (int i = 0; sorted && i < 100; i++)
+        sorted = order[i] == i;
+    CHECK(sorted);
+}
+
+struct Snapshot {
+    uint64_t seq;
+    uint64_t payload[15];
+};
+
+// The reader must only ever see snapshots written whole, in order, and end on the last one
+static void triple_buffer_snapshots() {
+    const uint64_t writes = 200000;
+    TripleBuffer<Snapshot> buffer(Snapshot{});
+    std::atomic<bool> finished(false);
+    std::thread writer([&] {
+        for (uint64_t seq = 1; seq <= writes; seq++) {
+            Snapshot& s = buffer.write_buffer();
+            s.seq = seq;
+            for (int i = 0; i < 15; i++)
+                s.payload[i] = seq * (i + 1);
+            buffer.publish();
+        }
+        finished = true;
+    });
+    uint64_t last = 0, reads = 0, torn = 0, backwards = 0;
+    while (true) {
+        bool done = finished.load();
+        const Snapshot& s = buffer.read();
+        for (int i = 0; i < 15; i++)
+            torn += s.payload[i] != s.seq * (i + 1);
+        backwards += s.seq < last;
+        last = s.seq;
+        reads++;
+        if (done)
+            break;
+    }
+    writer.join();
+    CHECK(!torn);
+    CHECK(!backwards);
+    CHECK(last == writes);
+    CHECK(buffer.read().seq == writes);
+    CHECK(reads > 1);
+}
+
+static void histogram_buckets() {
+    Histogram hist;
+    CHECK(hist.percentile(0.5) == 0 && hist.samples() == 0);
+
+    // Below 64 every value has its own bucket
+    for (uint64_t v = 0; v < 64; v++)
+        hist.record(v);
+    CHECK(hist.samples() == 64 && hist.max() == 63);
+    CHECK(hist.percentile(0) == 0);
+    CHECK(hist.percentile(0.5) == 32);
+    CHECK(hist.percentile(1) == 63);
+
+    // Above that, a value reports as the lower edge of its bucket, at most 1/32 below it
+    bool within = true;
+    for (uint64_t v : {64ull, 65ull, 100ull, 1000ull, 4095ull, 4096ull, 16666667ull, 1000000000ull, 1ull << 62}) {
+        Histogram single;
+        single.record(v);
+        single.record(v + v / 16 + 1);
+        uint64_t p = single.percentile(0);
+        within &= p <= v && p >= v - v / 32;
+    }
+    CHECK(within);
+
+    hist.reset();
+    for (uint64_t v = 1; v <= 1000; v++)
+        hist.record(v * 1000);
+    uint64_t p50 = hist.percentile(0.5), p99 = hist.percentile(0.99);
+    CHECK(p50 <= 501000 && p50 >= 501000 - 501000 / 32);
+    CHECK(p99 <= 991000 && p99 >= 991000 - 991000 / 32);
+    CHECK(hist.percentile(1) == 1000000 && hist.max() == 1000000);
+
+    hist.reset();
+    CHECK(hist.samples() == 0 && hist.max() == 0 && hist.percentile(0.99) == 0);
+}
+
+// At 10 fps, stalling 250 ms before the first wait misses the deadlines at 100 and 200 ms
+static void scheduler_skips_missed_frames() {
+    FrameScheduler scheduler(10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    scheduler.wait();
+    CHECK(scheduler.skipped_frames() == 2);
+    CHECK(scheduler.elapsed() >= 0.3);
+    scheduler.wait();
+    CHECK(scheduler.skipped_frames() == 2);
+    CHECK(scheduler.elapsed() >= 0.4);
+    CHECK(scheduler.frame_times().samples() == 2 && scheduler.jitter().samples() == 2);
+    CHECK(scheduler.frame_times().max() >= 250000000);
+}
+
+static bool near(const Matrix4& a, const Matrix4& b) {
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            if (std::fabs(a[std::pair<int, int>(r, c)] - b[std::pair<int, int>(r, c)]) > 1e-4f * (1 + std::fabs(b[std::pair<int, int>(r, c)])))
+                return false;
+    return true;
+}
+
+// The anchor/body pair main.cpp uses must match the matrix product it replaced
+static void transform_matches_product() {
+    Transform anchor, body;
+    body.set_parent(&anchor);
+    bool same = true;
+    for (float angle : {0.f, 1.f, 37.f, 123.5f, 1000.f}) {
+        anchor.set_translation(0, 1.5 * std::cos(0.08 * angle), 35);
+        body.set_rotation(0.2 * angle, 0.8 * angle, 1.0 * angle);
+        body.set_scale(4.5, 4.5, 4.5);
+        Matrix4 product = Matrix4::Translation(0, 1.5 * std::cos(0.08 * angle), 35) * Matrix4::Rotation(0, 0.2 * angle)
+            * Matrix4::Rotation(1, 0.8 * angle) * Matrix4::Rotation(2, 1.0 * angle) * Matrix4::Scale(4.5, 4.5, 4.5);
+        same &= near(body.world_matrix(), product);
+        same &= near(body.normal_matrix(), product.normal_matrix());
+    }
+    CHECK(same);
+}
+
+static void transform_dirty_propagation() {
+    Transform a, b, child, grandchild;
+    a.set_translation(1, 0, 0);
+    b.set_translation(0, 2, 0);
+    grandchild.set_parent(&child);
+    grandchild.set_translation(0, 0, 3);
+
+    child.set_parent(&a);
+    CHECK(near(grandchild.world_matrix(), Matrix4::Translation(1, 0, 3)));
+
+    // Re-parenting dirties the whole subtree
+    child.set_parent(&b);
+    CHECK(near(grandchild.world_matrix(), Matrix4::Translation(0, 2, 3)));
+
+    // So does changing an ancestor after the child's world matrix was cached
+    b.set_translation(0, 5, 0);
+    CHECK(near(grandchild.world_matrix(), Matrix4::Translation(0, 5, 3)));
+    b.set_scale(2, 2, 2);
+    CHECK(near(grandchild.world_matrix(), Matrix4::Translation(0, 5, 6) * Matrix4::Scale(2, 2, 2)));
+
+    child.set_parent(nullptr);
+    CHECK(near(grandchild.world_matrix(), Matrix4::Translation(0, 0, 3)));
+}
+
+static int squared_distance(int r, int g, int b, uint32_t rgb) {
+    int dr = r - (int)(rgb >> 16), dg = g - (int)((rgb >> 8) & 0xff), db = b - (int)(rgb & 0xff);
+    return dr*dr + dg*dg + db*db;
+}
+
+// RGB of an xterm-256 index from 16 on
+static uint32_t xterm_rgb(int idx) {
+    if (idx >= 232) {
+        int v = 8 + (idx - 232) * 10;
+        return (v << 16) | (v << 8) | v;
+    }
+    idx -= 16;
+    auto level = [](int l) { return l ? 55 + l * 40 : 0; };
+    return (level(idx / 36) << 16) | (level(idx / 6 % 6) << 8) | level(idx % 6);
+}
+
+static void color_quantize256() {
+    CHECK(Color(0, 0, 0).quantize256() == 16);
+    CHECK(Color(255, 255, 255).quantize256() == 231);
+    CHECK(Color(255, 0, 0).quantize256() == 196);
+    CHECK(Color(8, 8, 8).quantize256() == 232);
+    CHECK(Color(128, 128, 128).quantize256() == 244);
+    // Grays that sit exactly on a cube level stay in the cube, ones just off it go to the ramp
+    CHECK(Color(95, 95, 95).quantize256() == 59);
+    CHECK(Color(238, 238, 238).quantize256() == 255);
+    CHECK(Color(100, 100, 100).quantize256() == 241);
+
+    // Whatever side of the cube/ramp boundary a color falls on, no index is nearer than the one chosen
+    int worse = 0;
+    for (int r = 0; r < 256; r += 5) {
+        for (int g = 0; g < 256; g += 7) {
+            for (int b = 0; b < 256; b += 11) {
+                int chosen = squared_distance(r, g, b, xterm_rgb(Color(r, g, b).quantize256()));
+                int best = chosen;
+                for (int idx = 16; idx < 256; idx++)
+                    best = std::min(best, squared_distance(r, g, b, xterm_rgb(idx)));
+                worse += chosen > best;
+            }
+        }
+    }
+    CHECK(!worse);
+}
+
+static void color_quantize_levels() {
+    CHECK(Color(0, 128, 255).quantize(16) == 0x0088ff);
+    CHECK(Color(12, 34, 56).quantize(256) == 0x0c2238);
+    CHECK(Color(12, 34, 56).quantize(1) == 0x0c2238);
+    bool snapped = true;
+    for (int c = 0; c < 256; c++) {
+        uint32_t q = Color(c, c, c).quantize(16) & 0xff;
+        snapped &= q % 17 == 0 && std::abs((int)q - c) <= 8;
+    }
+    CHECK(snapped);
+    CHECK(Color(0, 0, 0).quantize(2) == 0 && Color(200, 100, 20).quantize(2) == 0xff0000);
+}
+
+// Renders two saturated quads side by side with blanks between them and counts the color escapes
+static int color_escapes(const Color& left, const Color& right, int& rows) {
+    Renderer renderer(32, 8, 1000, 0.3);
+    renderer.color_mode = ColorMode::TrueColor;
+    Matrix4 P = Matrix4::Perspective((32 / 2.0) / 8, 60, 1000, 0.3);
+    RectangularMesh quad(Vector4(-1, -1, 0, 1), Vector4(-1, 1, 0, 1), Vector4(1, 1, 0, 1), Vector4(1, -1, 0, 1));
+    quad.set_color(left);
+    Object other = quad;
+    other.set_color(right);
+    renderer.clear();
+    // An intensity this high saturates the shading, so every cell of a quad gets the same code
+    renderer.draw(P, Matrix4::Translation(-12, 0, 35) * Matrix4::Scale(6, 6, 1), quad, 100);
+    renderer.draw(P, Matrix4::Translation(12, 0, 35) * Matrix4::Scale(6, 6, 1), other, 100);
+
+    rows = 0;
+    const char* frame = renderer.frame();
+    for (int y = 0; y < 8; y++) {
+        std::string row(frame + y * renderer.frame_stride(), 32);
+        size_t first = row.find_first_not_of(' '), last = row.find_last_not_of(' ');
+        rows += first != std::string::npos && row.find(' ', first) < last;
+    }
+
+    std::ostringstream out;
+    std::streambuf* saved = std::cout.rdbuf(out.rdbuf());
+    renderer.render();
+    std::cout.rdbuf(saved);
+    std::string text = out.str();
+    int escapes = 0;
+    for (size_t at = text.find("\033[38;"); at != std::string::npos; at = text.find("\033[38;", at + 1))
+        escapes++;
+    CHECK(text.find("\033[0m") != std::string::npos);
+    return escapes;
+}
+
+static void render_coalesces_escapes() {
+    int rows;
+    // Blanks between two runs of one color never force a repeat, on the same row or the next
+    CHECK(color_escapes(Color(255, 0, 0), Color(255, 0, 0), rows) == 1);
+    CHECK(rows >= 4);
+    // Two colors switch twice per row
+    CHECK(color_escapes(Color(255, 0, 0), Color(0, 0, 255), rows) == 2 * rows);
+}
+
+struct Case {
+    const char* name;
+    void (*fn)();
+};
+
+static const Case cases[] = {
+    {"object_normals_shared", object_normals_shared},
+    {"c_api_matrices_and_pool", c_api_matrices_and_pool},
+    {"depth16_code_range", depth16_code_range},
+    {"jobs_parallel_for_exactly_once", jobs_parallel_for_exactly_once},
+    {"jobs_steal_imbalanced", jobs_steal_imbalanced},
+    {"jobs_wait_outside_workers", jobs_wait_outside_workers},
+    {"task_graph_order", task_graph_order},
+    {"triple_buffer_snapshots", triple_buffer_snapshots},
+    {"histogram_buckets", histogram_buckets},
+    {"scheduler_skips_missed_frames", scheduler_skips_missed_frames},
+    {"transform_matches_product", transform_matches_product},
+    {"transform_dirty_propagation", transform_dirty_propagation},
+    {"color_quantize256", color_quantize256},
+    {"color_quantize_levels", color_quantize_levels},
+    {"render_coalesces_escapes", render_coalesces_escapes},
+};
+
+int main(int argc, char** argv) {
+    int failed = 0;
+    for (const Case& c : cases) {
+        if (argc > 1 && !strstr(c.name, argv[1]))
+            continue;
+        int before = failures;
+        c.fn();
+        printf("%s %s\n", failures == before ? "[ OK ]" : "[FAIL]", c.name);
+        failed += failures != before;
+    }
+    if (failed)
+        printf("%d unit tests failed\n", failed);
+    return failed ? 1 : 0;
+}
\ No newline at end of file